@@ -0,0 +1,102 @@
+/*
+ * pdcache.h
+ *
+ * Dependency tracking for memoized predownload products. Each product
+ * (i.e. the spiral waveform, the view table) is a node holding a snapshot
+ * of the CV values it was last built from and the versions of the nodes it
+ * depends on. pdnode_stale() compares the current inputs and parent
+ * versions against the snapshot, and pdnode_commit() records them after a
+ * successful rebuild. Products that fail to build are never committed, so
+ * they are retried on the next call.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#define PDC_MAXIN 64 /* Maximum number of input values per node */
+#define PDC_MAXPAR 8 /* Maximum number of parent nodes per node */
+
+typedef struct pdnode {
+	char name[32];
+	int bit; /* bit of this node in the rebuilt bitmask */
+	int valid; /* 1 if the product has been built */
+	int ver; /* incremented on every rebuild, checked by dependent nodes */
+	int nbuilds; /* number of rebuilds */
+	int nin;
+	double in[PDC_MAXIN]; /* inputs from the last rebuild */
+	int newnin;
+	double newin[PDC_MAXIN]; /* inputs from the last check */
+	int npar;
+	struct pdnode *par[PDC_MAXPAR];
+	int parver[PDC_MAXPAR]; /* parent versions from the last rebuild */
+} pdnode;
+
+int pdnode_init(pdnode *node, const char *name, int bit);
+int pdnode_addparent(pdnode *node, pdnode *par);
+int pdnode_stale(pdnode *node, int nin, double *in, int force);
+int pdnode_commit(pdnode *node);
+
+int pdnode_init(pdnode *node, const char *name, int bit) {
+
+	memset(node, 0, sizeof(pdnode));
+	strncpy(node->name, name, sizeof(node->name) - 1);
+	node->bit = bit;
+
+	return 1;
+}
+
+int pdnode_addparent(pdnode *node, pdnode *par) {
+
+	if (node->npar >= PDC_MAXPAR) {
+		fprintf(stderr, "pdnode_addparent(): too many parents for %s\n", node->name);
+		return 0;
+	}
+	node->par[node->npar++] = par;
+
+	return 1;
+}
+
+int pdnode_stale(pdnode *node, int nin, double *in, int force) {
+
+	int n;
+	int stale = (force || !node->valid || nin != node->nin);
+
+	if (nin > PDC_MAXIN) {
+		fprintf(stderr, "pdnode_stale(): too many inputs for %s\n", node->name);
+		nin = PDC_MAXIN;
+		stale = 1;
+	}
+
+	/* save the inputs for the commit */
+	for (n = 0; n < nin; n++)
+		node->newin[n] = in[n];
+	node->newnin = nin;
+
+	/* compare the inputs to the snapshot */
+	for (n = 0; n < nin && !stale; n++)
+		stale = (in[n] != node->in[n]);
+
+	/* check if any parents were rebuilt (or failed to build) */
+	for (n = 0; n < node->npar && !stale; n++)
+		stale = (!node->par[n]->valid || node->par[n]->ver != node->parver[n]);
+
+	/* invalidate until the rebuild is committed */
+	if (stale)
+		node->valid = 0;
+
+	return stale;
+}
+
+int pdnode_commit(pdnode *node) {
+
+	int n;
+	for (n = 0; n < node->newnin; n++)
+		node->in[n] = node->newin[n];
+	node->nin = node->newnin;
+	for (n = 0; n < node->npar; n++)
+		node->parver[n] = node->par[n]->ver;
+	node->valid = 1;
+	node->ver++;
+	node->nbuilds++;
+
+	return 1;
+}
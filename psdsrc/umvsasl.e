@@ -166,6 +166,7 @@ int kill_grads = 0 with {0, 1, 0, VIS, "option to turn off readout gradients",};
 int nnav = 250 with {0, 1000, 250, VIS, "number of navigator points in spiral",};
 int narms = 1 with {1, 1000, 1, VIS, "number of spiral arms",};
 int spi_mode = 0 with {0, 2, 0, VIS, "SOS (0), TGA (1), or 3DTGA (2)",};
+int frame_rot = 0 with {0, 1, 0, VIS, "option to rotate the views of each frame by the golden angle (for joint multi-frame recon)",};
 float kz_acc = 1.0 with {1, 100.0, 1.0, VIS, "kz acceleration (SENSE) factor (for SOS only)",};
 float vds_acc0 = 1.0 with {0.001, 50.0, 1.0, VIS, "spiral center oversampling factor",};
 float vds_acc1 = 1.0 with {0.001, 50.0, 1.0, VIS, "spiral edge oversampling factor",};
@@ -199,6 +200,12 @@ int prep2_tbgs2 = 0 with {0, , 0, VIS, "ASL prep pulse 2: 2nd background suppres
 int prep2_tbgs3 = 0 with {0, , 0, VIS, "ASL prep pulse 2: 3rd background suppression delay (0 = no pulse)",};
 int prep2_b1calib = 0 with {0, 1, 0, VIS, "ASL prep pulse 2: option to sweep B1 amplitudes across frames from 0 to nominal B1",};
 
+/* Declare predownload cache variables */
+int pdcache_flag = 1 with {0, 1, 1, INVIS, "option to reuse predownload products whose inputs did not change (0 = always rebuild)",};
+int pdcache_ncalls = 0 with {0, , 0, INVIS, "number of predownload calls",};
+int pdcache_nrebuilt = 0 with {0, , 0, INVIS, "number of predownload products rebuilt in the last call",};
+int pdcache_rebuilt = 0 with {0, , 0, INVIS, "bitmask of predownload products rebuilt in the last call (see PD_* bits)",};
+
 /* Declare core duration variables */
 int dur_presatcore = 0 with {0, , 0, INVIS, "duration of the ASL pre-saturation core (us)",};
 int dur_prep1core = 0 with {0, , 0, INVIS, "duration of the ASL prep 1 cores (us)",};
@@ -237,6 +244,7 @@ float echo1bw = 16 with {,,,INVIS,"Echo1 filter bw.in KHz",};
 #include "sar_pm.h"
 #include "support_func.host.h"
 #include "helperfuns.h"
+#include "pdcache.h"
 #include "vds.c"
 
 /* fec : Field strength dependency library */
@@ -280,6 +288,30 @@ float calc_sinc_B1(float cyc_rf, int pw_rf, float flip_rf);
 float calc_hard_B1(int pw_rf, float flip_rf);
 int write_scan_info();
 
+/* Predownload products and their pdcache_rebuilt bits */
+#define PD_PREP1 1 /* prep 1 waveforms */
+#define PD_PREP2 2 /* prep 2 waveforms */
+#define PD_B1 4 /* peak B1 and transmit scaling */
+#define PD_CRUSH 8 /* crushers and slice select refocusers */
+#define PD_ZENC 16 /* kz-encode, rewinder and flowcomp gradients */
+#define PD_SPIRAL 32 /* spiral waveform and ktraj.txt */
+#define PD_VIEWS 64 /* view transformations and kviews.txt */
+#define PD_TIMING 128 /* deadtimes, core durations and minimum timing */
+#define PD_SCANINFO 256 /* scaninfo.txt */
+pdnode pd_prep1, pd_prep2, pd_b1, pd_crush, pd_zenc, pd_spiral, pd_views, pd_timing, pd_scaninfo;
+
+/* Trapezoid designs from amppwgrad(), kept with the pd_crush and pd_zenc products */
+typedef struct {
+	float a;
+	int pwa, pw, pwd;
+} trapgrad;
+trapgrad trap_crush, trap_ssref, trap_gzw1, trap_gzw2, trap_gzfc;
+
+/* Declare predownload cache function prototypes */
+int pdcache_setup();
+int pdcache_built(pdnode *node);
+int settrap(trapgrad *trap, float *a, int *pwa, int *pw, int *pwd);
+
 @inline Prescan.e PShostVars            /* added with new filter calcs */
 
 static char supfailfmt[] = "Support routine %s failed";
@@ -409,6 +441,9 @@ STATUS cvinit( void )
 	ZGRAD_risetime *= 2; /* extra fluffy */
 	fprintf(stderr, "ZGRAD_risetime = %d\n", ZGRAD_risetime);	
 
+	/* Set up the predownload product dependencies */
+	pdcache_setup();
+
 @inline Prescan.e PScvinit
 
 #include "cvinit.in"	/* Runs the code generated by macros in preproc.*/
@@ -772,37 +807,56 @@ STATUS cvcheck( void )
 STATUS predownload( void )
 {
 	int echo1_freq[opslquant], rf1_freq[opslquant];
-	int slice;
+	int slice, n;
 	float kzmax;
-	int minesp, minte, absmintr;	
-	float rf0_b1, rf1_b1;
-	float rfps1_b1, rfps2_b1, rfps3_b1, rfps4_b1;
-	float rffs_b1, rfbs_b1;
-	float prep1_b1, prep2_b1;
-	int tmp_pwa, tmp_pw, tmp_pwd;
-	float tmp_a, tmp_area;
+	static int minesp, minte, absmintr; /* static to keep the memoized products */
+	static float rf0_b1, rf1_b1;
+	static float rfps1_b1, rfps2_b1, rfps3_b1, rfps4_b1;
+	static float rffs_b1, rfbs_b1;
+	static float prep1_b1, prep2_b1;
+	float tmp_area;
+	double in[PDC_MAXIN];
+	int nin;
+	int force = (pdcache_flag == 0);
 
 	/*********************************************************************/
 #include "predownload.in"	/* include 'canned' predownload code */
 	/*********************************************************************/
+
+	/* reset the rebuild counters */
+	pdcache_ncalls++;
+	pdcache_rebuilt = 0;
+	pdcache_nrebuilt = 0;
 	
 	/* Read in asl prep pulses */
-	fprintf(stderr, "predownload(): calling readprep() to read in ASL prep 1 pulse\n");
-	if (readprep(prep1_id, &prep1_len,
-		prep1_rho_lbl, prep1_theta_lbl, prep1_grad_lbl,
-		prep1_rho_ctl, prep1_theta_ctl, prep1_grad_ctl) == 0)
-	{
-		epic_error(use_ermes,"failure to read in ASL prep 1 pulse", EM_PSD_SUPPORT_FAILURE, EE_ARGS(0));
-		return FAILURE;
+	nin = 0;
+	in[nin++] = prep1_id;
+	in[nin++] = zero_ctl_grads;
+	if (pdnode_stale(&pd_prep1, nin, in, force)) {
+		fprintf(stderr, "predownload(): calling readprep() to read in ASL prep 1 pulse\n");
+		if (readprep(prep1_id, &prep1_len,
+			prep1_rho_lbl, prep1_theta_lbl, prep1_grad_lbl,
+			prep1_rho_ctl, prep1_theta_ctl, prep1_grad_ctl) == 0)
+		{
+			epic_error(use_ermes,"failure to read in ASL prep 1 pulse", EM_PSD_SUPPORT_FAILURE, EE_ARGS(0));
+			return FAILURE;
+		}
+		pdcache_built(&pd_prep1);
 	}
-	
-	fprintf(stderr, "predownload(): calling readprep() to read in ASL prep 2 pulse\n");
-	if (readprep(prep2_id, &prep2_len,
-		prep2_rho_lbl, prep2_theta_lbl, prep2_grad_lbl,
-		prep2_rho_ctl, prep2_theta_ctl, prep2_grad_ctl) == 0)
-	{
-		epic_error(use_ermes,"failure to read in ASL prep 2 pulse", EM_PSD_SUPPORT_FAILURE, EE_ARGS(0));
-		return FAILURE;
+
+	nin = 0;
+	in[nin++] = prep2_id;
+	in[nin++] = zero_ctl_grads;
+	if (pdnode_stale(&pd_prep2, nin, in, force)) {
+		fprintf(stderr, "predownload(): calling readprep() to read in ASL prep 2 pulse\n");
+		if (readprep(prep2_id, &prep2_len,
+			prep2_rho_lbl, prep2_theta_lbl, prep2_grad_lbl,
+			prep2_rho_ctl, prep2_theta_ctl, prep2_grad_ctl) == 0)
+		{
+			epic_error(use_ermes,"failure to read in ASL prep 2 pulse", EM_PSD_SUPPORT_FAILURE, EE_ARGS(0));
+			return FAILURE;
+		}
+		pdcache_built(&pd_prep2);
 	}
 	
 	/* update presat pulse parameters */
@@ -834,87 +888,111 @@ STATUS predownload( void )
 	res_rfbs_theta = res_rfbs_rho;
 	pw_rfbs_theta = pw_rfbs_rho;
 		
-	/* First, find the peak B1 for all entry points (other than L_SCAN) */
-	for( entry=0; entry < MAX_ENTRY_POINTS; ++entry )
-	{
-		if( peakB1( &maxB1[entry], entry, RF_FREE, rfpulse ) == FAILURE )
+	/* Calculate the peak B1 of all pulses */
+	nin = 0;
+	in[nin++] = opflip;
+	in[nin++] = cyc_rf0;
+	in[nin++] = ro_type;
+	in[nin++] = presat_flag;
+	in[nin++] = cyc_rf1;
+	in[nin++] = cyc_rffs;
+	in[nin++] = pw_rf0;
+	in[nin++] = pw_rf1;
+	in[nin++] = pw_rffs;
+	in[nin++] = pw_rfbs_rho;
+	in[nin++] = fatsup_mode;
+	in[nin++] = spir_fa;
+	in[nin++] = prep1_id;
+	in[nin++] = prep1_rfmax;
+	in[nin++] = prep2_id;
+	in[nin++] = prep2_rfmax;
+	in[nin++] = getCoilAtten();
+	in[nin++] = cfdbmax;
+	if (pdnode_stale(&pd_b1, nin, in, force)) {
+		/* First, find the peak B1 for all entry points (other than L_SCAN) */
+		for( entry=0; entry < MAX_ENTRY_POINTS; ++entry )
 		{
-			epic_error( use_ermes, "peakB1 failed.", EM_PSD_SUPPORT_FAILURE,
-					EE_ARGS(1), STRING_ARG, "peakB1" );
-			return FAILURE;
+			if( peakB1( &maxB1[entry], entry, RF_FREE, rfpulse ) == FAILURE )
+			{
+				epic_error( use_ermes, "peakB1 failed.", EM_PSD_SUPPORT_FAILURE,
+						EE_ARGS(1), STRING_ARG, "peakB1" );
+				return FAILURE;
+			}
 		}
-	}
 	
-	rf0_b1 = calc_sinc_B1(cyc_rf0, pw_rf0, 90.0);
-	fprintf(stderr, "predownload(): maximum B1 for rf0 pulse: %f\n", rf0_b1);
-	if (rf0_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rf0_b1;
+		rf0_b1 = calc_sinc_B1(cyc_rf0, pw_rf0, 90.0);
+		fprintf(stderr, "predownload(): maximum B1 for rf0 pulse: %f\n", rf0_b1);
+		if (rf0_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rf0_b1;
 
-	rf1_b1 = calc_sinc_B1(cyc_rf1, pw_rf1, opflip);
-	fprintf(stderr, "predownload(): maximum B1 for rf1 pulse: %f\n", rf1_b1);
-	if (rf1_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rf1_b1;
+		rf1_b1 = calc_sinc_B1(cyc_rf1, pw_rf1, opflip);
+		fprintf(stderr, "predownload(): maximum B1 for rf1 pulse: %f\n", rf1_b1);
+		if (rf1_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rf1_b1;
 	
-	rfps1_b1 = calc_hard_B1(pw_rfps1, 72.0); /* flip angle of 72 degrees */
-	fprintf(stderr, "predownload(): maximum B1 for presat pulse 1: %f Gauss \n", rfps1_b1);
-	if (rfps1_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rfps1_b1;
+		rfps1_b1 = calc_hard_B1(pw_rfps1, 72.0); /* flip angle of 72 degrees */
+		fprintf(stderr, "predownload(): maximum B1 for presat pulse 1: %f Gauss \n", rfps1_b1);
+		if (rfps1_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rfps1_b1;
 	
-	rfps2_b1 = calc_hard_B1(pw_rfps2, 92.0); /* flip angle of 92 degrees */
-	fprintf(stderr, "predownload(): maximum B1 for presat pulse 2: %f Gauss \n", rfps2_b1);
-	if (rfps2_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rfps2_b1;
+		rfps2_b1 = calc_hard_B1(pw_rfps2, 92.0); /* flip angle of 92 degrees */
+		fprintf(stderr, "predownload(): maximum B1 for presat pulse 2: %f Gauss \n", rfps2_b1);
+		if (rfps2_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rfps2_b1;
 	
-	rfps3_b1 = calc_hard_B1(pw_rfps3, 126.0); /* flip angle of 126 degrees */
-	fprintf(stderr, "predownload(): maximum B1 for presat pulse 3: %f Gauss \n", rfps3_b1);
-	if (rfps3_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rfps3_b1;
+		rfps3_b1 = calc_hard_B1(pw_rfps3, 126.0); /* flip angle of 126 degrees */
+		fprintf(stderr, "predownload(): maximum B1 for presat pulse 3: %f Gauss \n", rfps3_b1);
+		if (rfps3_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rfps3_b1;
 	
-	rfps4_b1 = calc_hard_B1(pw_rfps4, 193.0); /* flip angle of 193 degrees */
-	fprintf(stderr, "predownload(): maximum B1 for presat pulse 4: %f Gauss \n", rfps4_b1);
-	if (rfps4_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rfps4_b1;
+		rfps4_b1 = calc_hard_B1(pw_rfps4, 193.0); /* flip angle of 193 degrees */
+		fprintf(stderr, "predownload(): maximum B1 for presat pulse 4: %f Gauss \n", rfps4_b1);
+		if (rfps4_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rfps4_b1;
 
-	rfbs_b1 = 0.234;
-	fprintf(stderr, "predownload(): maximum B1 for background suppression prep pulse: %f Gauss \n", rfbs_b1);
-	if (rfbs_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rfbs_b1;
+		rfbs_b1 = 0.234;
+		fprintf(stderr, "predownload(): maximum B1 for background suppression prep pulse: %f Gauss \n", rfbs_b1);
+		if (rfbs_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rfbs_b1;
 	
-	if (fatsup_mode < 2)
-		rffs_b1 = calc_sinc_B1(cyc_rffs, pw_rffs, 90.0);
-	else
-		rffs_b1 = calc_sinc_B1(cyc_rffs, pw_rffs, spir_fa);
-	fprintf(stderr, "predownload(): maximum B1 for fatsup pulse: %f Gauss\n", rffs_b1);
-	if (rffs_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rffs_b1;
-	
-	prep1_b1 = (prep1_id > 0) ? (prep1_rfmax*1e-3) : (0);
-	fprintf(stderr, "predownload(): maximum B1 for prep1 pulse: %f Gauss\n", prep1_b1);
-	if (prep1_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = prep1_b1;
-
-	prep2_b1 = (prep2_id > 0) ? (prep2_rfmax*1e-3) : (0);
-	fprintf(stderr, "predownload(): maximum B1 for prep2 pulse: %f Gauss\n", prep2_b1);
-	if (prep2_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = prep2_b1;
-	
-	/* Determine peak B1 across all entry points */
-	maxB1Seq = 0.0;
-	for (entry=0; entry < MAX_ENTRY_POINTS; entry++) {
-		if (entry != L_SCAN) { /* since we aleady computed the peak B1 for L_SCAN entry point */
-			if (peakB1(&maxB1[entry], entry, RF_FREE, rfpulse) == FAILURE) {
-				epic_error(use_ermes,"peakB1 failed",EM_PSD_SUPPORT_FAILURE,1,STRING_ARG,"peakB1");
-				return FAILURE;
+		if (fatsup_mode < 2)
+			rffs_b1 = calc_sinc_B1(cyc_rffs, pw_rffs, 90.0);
+		else
+			rffs_b1 = calc_sinc_B1(cyc_rffs, pw_rffs, spir_fa);
+		fprintf(stderr, "predownload(): maximum B1 for fatsup pulse: %f Gauss\n", rffs_b1);
+		if (rffs_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = rffs_b1;
+	
+		prep1_b1 = (prep1_id > 0) ? (prep1_rfmax*1e-3) : (0);
+		fprintf(stderr, "predownload(): maximum B1 for prep1 pulse: %f Gauss\n", prep1_b1);
+		if (prep1_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = prep1_b1;
+
+		prep2_b1 = (prep2_id > 0) ? (prep2_rfmax*1e-3) : (0);
+		fprintf(stderr, "predownload(): maximum B1 for prep2 pulse: %f Gauss\n", prep2_b1);
+		if (prep2_b1 > maxB1[L_SCAN]) maxB1[L_SCAN] = prep2_b1;
+	
+		/* Determine peak B1 across all entry points */
+		maxB1Seq = 0.0;
+		for (entry=0; entry < MAX_ENTRY_POINTS; entry++) {
+			if (entry != L_SCAN) { /* since we aleady computed the peak B1 for L_SCAN entry point */
+				if (peakB1(&maxB1[entry], entry, RF_FREE, rfpulse) == FAILURE) {
+					epic_error(use_ermes,"peakB1 failed",EM_PSD_SUPPORT_FAILURE,1,STRING_ARG,"peakB1");
+					return FAILURE;
+				}
 			}
+			if (maxB1[entry] > maxB1Seq)
+				maxB1Seq = maxB1[entry];
 		}
-		if (maxB1[entry] > maxB1Seq)
-			maxB1Seq = maxB1[entry];
-	}
-	fprintf(stderr, "predownload(): maxB1Seq = %f Gauss\n", maxB1Seq);
+		fprintf(stderr, "predownload(): maxB1Seq = %f Gauss\n", maxB1Seq);
 	
-	/* Set xmtadd according to maximum B1 and rescale for powermon,
-	   adding additional (audio) scaling if xmtadd is too big.
-	   Add in coilatten, too. */
-	xmtaddScan = -200 * log10( maxB1[L_SCAN] / maxB1Seq ) + getCoilAtten(); 
+		/* Set xmtadd according to maximum B1 and rescale for powermon,
+		   adding additional (audio) scaling if xmtadd is too big.
+		   Add in coilatten, too. */
+		xmtaddScan = -200 * log10( maxB1[L_SCAN] / maxB1Seq ) + getCoilAtten(); 
 
-	if( xmtaddScan > cfdbmax )
-	{
-		extraScale = (float)pow( 10.0, (cfdbmax - xmtaddScan) / 200.0 );
-		xmtaddScan = cfdbmax;
-	} 
-	else
-	{
-		extraScale = 1.0;
+		if( xmtaddScan > cfdbmax )
+		{
+			extraScale = (float)pow( 10.0, (cfdbmax - xmtaddScan) / 200.0 );
+			xmtaddScan = cfdbmax;
+		} 
+		else
+		{
+			extraScale = 1.0;
+		}
+
+		pdcache_built(&pd_b1);
 	}
 	
 	/* Update all the rf amplitudes */
@@ -960,99 +1038,103 @@ STATUS predownload( void )
 	a_prep2gradctl = (prep2_id > 0) ? (prep2_gmax) : (0); 
 	ia_prep2gradctl = (int)ceil(a_prep2gradctl / ZGRAD_max * (float)MAX_PG_WAMP);
 	
-	/* Set the parameters for the spin echo rf1 kspace rewinder */
-	tmp_area = a_gzrf1 * (pw_gzrf1 + (pw_gzrf1a + pw_gzrf1d)/2.0);
-	amppwgrad(tmp_area, GMAX, 0, 0, ZGRAD_risetime, 0, &tmp_a, &tmp_pwa, &tmp_pw, &tmp_pwd); 
-	tmp_a *= -0.5;
-	pw_gzrf1trap2 = tmp_pw;
-	pw_gzrf1trap2a = tmp_pwa;
-	pw_gzrf1trap2d = tmp_pwd;
-	a_gzrf1trap2 = tmp_a;
+	/* Design the crusher and slice select refocuser gradients */
+	nin = 0;
+	in[nin++] = crushfac;
+	in[nin++] = opxres;
+	in[nin++] = opfov;
+	in[nin++] = a_gzrf1;
+	in[nin++] = pw_gzrf1;
+	in[nin++] = pw_gzrf1a;
+	in[nin++] = pw_gzrf1d;
+	in[nin++] = GMAX;
+	in[nin++] = ZGRAD_risetime;
+	if (pdnode_stale(&pd_crush, nin, in, force)) {
+
+		/* Area under crusher s.t. dk = crushfac*kmax (G/cm*us) */
+		tmp_area = crushfac * 2*M_PI/GAMMA * opxres/(opfov/10.0) * 1e6;
+		amppwgrad(tmp_area, GMAX, 0, 0, ZGRAD_risetime, 0, &trap_crush.a, &trap_crush.pwa, &trap_crush.pw, &trap_crush.pwd);
+
+		/* slice select refocuser (rewinds half of the rf1 slice select area) */
+		tmp_area = a_gzrf1 * (pw_gzrf1 + (pw_gzrf1a + pw_gzrf1d)/2.0);
+		amppwgrad(tmp_area, GMAX, 0, 0, ZGRAD_risetime, 0, &trap_ssref.a, &trap_ssref.pwa, &trap_ssref.pw, &trap_ssref.pwd);
+		trap_ssref.a *= -0.5;
+
+		pdcache_built(&pd_crush);
+	}
 
 	/* Set the parameters for the crusher gradients */
-	tmp_area = crushfac * 2*M_PI/GAMMA * opxres/(opfov/10.0) * 1e6; /* Area under crusher s.t. dk = crushfac*kmax (G/cm*us) */
-	amppwgrad(tmp_area, GMAX, 0, 0, ZGRAD_risetime, 0, &tmp_a, &tmp_pwa, &tmp_pw, &tmp_pwd); 	
-	
-	pw_rfps1c = tmp_pw;
-	pw_rfps1ca = tmp_pwa;
-	pw_rfps1cd = tmp_pwd;
-	a_rfps1c = tmp_a;
-	pw_rfps2c = tmp_pw;
-	pw_rfps2ca = tmp_pwa;
-	pw_rfps2cd = tmp_pwd;
-	a_rfps2c = tmp_a;
-	pw_rfps3c = tmp_pw;
-	pw_rfps3ca = tmp_pwa;
-	pw_rfps3cd = tmp_pwd;
-	a_rfps3c = tmp_a;
-	pw_rfps4c = tmp_pw;
-	pw_rfps4ca = tmp_pwa;
-	pw_rfps4cd = tmp_pwd;
-	a_rfps4c = tmp_a;
-
-	pw_gzrffsspoil = tmp_pw;
-	pw_gzrffsspoila = tmp_pwa;
-	pw_gzrffsspoild = tmp_pwd;
-	a_gzrffsspoil = tmp_a;
-
-	pw_gzrf1trap1 = tmp_pw;
-	pw_gzrf1trap1a = tmp_pwa;
-	pw_gzrf1trap1d = tmp_pwd;
-	a_gzrf1trap1 = tmp_a;
-
-	/* set trap2 as a crusher (for FSE case) */
-	pw_gzrf1trap2 = tmp_pw;
-	pw_gzrf1trap2a = tmp_pwa;
-	pw_gzrf1trap2d = tmp_pwd;
-	a_gzrf1trap2 = tmp_a;
-	
-	/* calculate slice select refocuser gradient */
-	tmp_area = a_gzrf1 * (pw_gzrf1 + (pw_gzrf1a + pw_gzrf1d)/2.0);
-	amppwgrad(tmp_area, GMAX, 0, 0, ZGRAD_risetime, 0, &tmp_a, &tmp_pwa, &tmp_pw, &tmp_pwd); 	
-	tmp_a *= -0.5;
-	
-	pw_gzrf0r = tmp_pw;
-	pw_gzrf0ra = tmp_pwa;
-	pw_gzrf0rd = tmp_pwd;
-	a_gzrf0r = tmp_a;
-	
-	if (ro_type > 1) { /* GRE modes - make trap2 a slice selct refocuser */
-		pw_gzrf1trap2 = tmp_pw;
-		pw_gzrf1trap2a = tmp_pwa;
-		pw_gzrf1trap2d = tmp_pwd;
-		a_gzrf1trap2 = tmp_a;
+	settrap(&trap_crush, &a_rfps1c, &pw_rfps1ca, &pw_rfps1c, &pw_rfps1cd);
+	settrap(&trap_crush, &a_rfps2c, &pw_rfps2ca, &pw_rfps2c, &pw_rfps2cd);
+	settrap(&trap_crush, &a_rfps3c, &pw_rfps3ca, &pw_rfps3c, &pw_rfps3cd);
+	settrap(&trap_crush, &a_rfps4c, &pw_rfps4ca, &pw_rfps4c, &pw_rfps4cd);
+	settrap(&trap_crush, &a_gzrffsspoil, &pw_gzrffsspoila, &pw_gzrffsspoil, &pw_gzrffsspoild);
+	settrap(&trap_crush, &a_gzrf1trap1, &pw_gzrf1trap1a, &pw_gzrf1trap1, &pw_gzrf1trap1d);
+
+	/* set the rf0 slice select refocuser */
+	settrap(&trap_ssref, &a_gzrf0r, &pw_gzrf0ra, &pw_gzrf0r, &pw_gzrf0rd);
+
+	if (ro_type > 1) /* GRE modes - make trap2 a slice selct refocuser */
+		settrap(&trap_ssref, &a_gzrf1trap2, &pw_gzrf1trap2a, &pw_gzrf1trap2, &pw_gzrf1trap2d);
+	else /* set trap2 as a crusher (for FSE case) */
+		settrap(&trap_crush, &a_gzrf1trap2, &pw_gzrf1trap2a, &pw_gzrf1trap2, &pw_gzrf1trap2d);
+
+	/* Design the kz-encode gradients */
+	nin = 0;
+	in[nin++] = kz_acc;
+	in[nin++] = opetl;
+	in[nin++] = opnshots;
+	in[nin++] = opfov;
+	in[nin++] = flowcomp_flag;
+	in[nin++] = GMAX;
+	in[nin++] = ZGRAD_risetime;
+	if (pdnode_stale(&pd_zenc, nin, in, force)) {
+
+		/* flow compensated kz-encode (pre-scaled to kzmax) */
+		kzmax = (float)(kz_acc * opetl * opnshots) / ((float)opfov/10.0) / 2.0;
+		tmp_area = 2*M_PI/(GAMMA*1e-6) * kzmax * (1 + flowcomp_flag); /* multiply by 2 if flow compensated */
+		amppwgrad(tmp_area, GMAX, 0, 0, ZGRAD_risetime, 0, &trap_gzw1.a, &trap_gzw1.pwa, &trap_gzw1.pw, &trap_gzw1.pwd);
+
+		/* kz-rewinder */
+		tmp_area = 2*M_PI/(GAMMA*1e-6) * kzmax;
+		amppwgrad(tmp_area, GMAX, 0, 0, ZGRAD_risetime, 0, &trap_gzw2.a, &trap_gzw2.pwa, &trap_gzw2.pw, &trap_gzw2.pwd);
+
+		/* flowcomp pre-phaser */
+		tmp_area = 2*M_PI/(GAMMA*1e-6) * kzmax;
+		amppwgrad(tmp_area, GMAX, 0, 0, ZGRAD_risetime, 0, &trap_gzfc.a, &trap_gzfc.pwa, &trap_gzfc.pw, &trap_gzfc.pwd);
+		trap_gzfc.a *= -1;
+
+		pdcache_built(&pd_zenc);
 	}
-
-	/* set parameters for flow compensated kz-encode (pre-scaled to kzmax) */
-	kzmax = (float)(kz_acc * opetl * opnshots) / ((float)opfov/10.0) / 2.0;
-	tmp_area = 2*M_PI/(GAMMA*1e-6) * kzmax * (1 + flowcomp_flag); /* multiply by 2 if flow compensated */
-	amppwgrad(tmp_area, GMAX, 0, 0, ZGRAD_risetime, 0, &tmp_a, &tmp_pwa, &tmp_pw, &tmp_pwd); 	
-	pw_gzw1 = tmp_pw;
-	pw_gzw1a = tmp_pwa;
-	pw_gzw1d = tmp_pwd;
-	a_gzw1 = tmp_a;
-	
-	/* set parameters with the kz-rewinder */
-	tmp_area = 2*M_PI/(GAMMA*1e-6) * kzmax;
-	amppwgrad(tmp_area, GMAX, 0, 0, ZGRAD_risetime, 0, &tmp_a, &tmp_pwa, &tmp_pw, &tmp_pwd); 	
-	pw_gzw2 = tmp_pw;
-	pw_gzw2a = tmp_pwa;
-	pw_gzw2d = tmp_pwd;
-	a_gzw2 = tmp_a;
-
-	/* set parameters for flowcomp pre-phaser */
-	tmp_area = 2*M_PI/(GAMMA*1e-6) * kzmax; /* multiply by 2 if flow compensated */
-	amppwgrad(tmp_area, GMAX, 0, 0, ZGRAD_risetime, 0, &tmp_a, &tmp_pwa, &tmp_pw, &tmp_pwd); 
-	pw_gzfc = tmp_pw;
-	pw_gzfca = tmp_pwa;
-	pw_gzfcd = tmp_pwd;
-	a_gzfc = -tmp_a;
+	settrap(&trap_gzw1, &a_gzw1, &pw_gzw1a, &pw_gzw1, &pw_gzw1d);
+	settrap(&trap_gzw2, &a_gzw2, &pw_gzw2a, &pw_gzw2, &pw_gzw2d);
+	settrap(&trap_gzfc, &a_gzfc, &pw_gzfca, &pw_gzfc, &pw_gzfcd);
 	
 	/* generate initial spiral trajectory */
-	fprintf(stderr, "predownload(): calculating spiral gradients...\n");
-	if (genspiral() == 0) {
-		epic_error(use_ermes,"failure to generate spiral waveform", EM_PSD_SUPPORT_FAILURE, EE_ARGS(0));
-		return FAILURE;
+	nin = 0;
+	in[nin++] = SLEWMAX;
+	in[nin++] = GMAX;
+	in[nin++] = XGRAD_max;
+	in[nin++] = YGRAD_max;
+	in[nin++] = ZGRAD_risetime;
+	in[nin++] = opxres;
+	in[nin++] = opfov;
+	in[nin++] = vds_acc0;
+	in[nin++] = vds_acc1;
+	in[nin++] = narms;
+	in[nin++] = nnav;
+	in[nin++] = ro_type;
+	in[nin++] = spi_mode;
+	in[nin++] = kz_acc;
+	in[nin++] = opetl;
+	in[nin++] = opnshots;
+	if (pdnode_stale(&pd_spiral, nin, in, force)) {
+		fprintf(stderr, "predownload(): calculating spiral gradients...\n");
+		if (genspiral() == 0) {
+			epic_error(use_ermes,"failure to generate spiral waveform", EM_PSD_SUPPORT_FAILURE, EE_ARGS(0));
+			return FAILURE;
+		}
+		pdcache_built(&pd_spiral);
 	}
 	a_gxw = XGRAD_max;
 	a_gyw = YGRAD_max;
@@ -1064,260 +1146,315 @@ STATUS predownload( void )
 	pw_gyw = GRAD_UPDATE_TIME*res_gyw;
 	
 	/* Generate view transformations */
-	if (genviews() == 0) {
-		epic_error(use_ermes,"failure to generate view transformation matrices", EM_PSD_SUPPORT_FAILURE, EE_ARGS(0));
-		return FAILURE;
+	nin = 0;
+	in[nin++] = narms;
+	in[nin++] = opnshots;
+	in[nin++] = opetl;
+	in[nin++] = ro_type;
+	in[nin++] = spi_mode;
+	in[nin++] = frame_rot;
+	in[nin++] = (frame_rot) ? (nframes) : (1); /* nframes only changes the views if they rotate across frames */
+	for (n = 0; n < 9; n++)
+		in[nin++] = rsprot[0][n];
+	in[nin++] = loggrd.xfs;
+	in[nin++] = loggrd.yfs;
+	in[nin++] = loggrd.zfs;
+	if (pdnode_stale(&pd_views, nin, in, force)) {
+		if (frame_rot && nframes*narms*opnshots*opetl > MAXNSHOTS*MAXNECHOES) {
+			epic_error(use_ermes,"too many views for frame rotation (nframes*narms*nshots*etl)", EM_PSD_SUPPORT_FAILURE, EE_ARGS(0));
+			return FAILURE;
+		}
+		if (genviews() == 0) {
+			epic_error(use_ermes,"failure to generate view transformation matrices", EM_PSD_SUPPORT_FAILURE, EE_ARGS(0));
+			return FAILURE;
+		}
+		scalerotmats(tmtxtbl, &loggrd, &phygrd, (frame_rot ? nframes : 1)*opetl*opnshots*narms, 0);
+		pdcache_built(&pd_views);
 	}
-	scalerotmats(tmtxtbl, &loggrd, &phygrd, opetl*opnshots*narms, 0);
 
-	/* calculate minimum echo time and esp, and corresponding deadtimes */
-	minesp = 0;
-	minte = 0;
-	switch (ro_type) {
-		case 1: /* FSE */
+	/* Calculate the timing */
+	nin = 0;
+	in[nin++] = ro_type;
+	in[nin++] = opte;
+	in[nin++] = esp;
+	in[nin++] = opetl;
+	in[nin++] = ndisdaqechoes;
+	in[nin++] = flowcomp_flag;
+	in[nin++] = spi_mode;
+	in[nin++] = pgbuffertime;
+	in[nin++] = fatsup_mode;
+	in[nin++] = spir_ti;
+	in[nin++] = pw_rffs;
+	in[nin++] = pw_rfbs_rho;
+	in[nin++] = pw_rfps1;
+	in[nin++] = pw_rfps2;
+	in[nin++] = pw_rfps3;
+	in[nin++] = pw_rfps4;
+	in[nin++] = pw_gzrf0;
+	in[nin++] = pw_gzrf0a;
+	in[nin++] = pw_gzrf0d;
+	in[nin++] = pw_gzrf1;
+	in[nin++] = pw_gzrf1a;
+	in[nin++] = pw_gzrf1d;
+	in[nin++] = presat_flag;
+	in[nin++] = presat_delay;
+	in[nin++] = prep1_id;
+	in[nin++] = prep1_pld;
+	in[nin++] = prep2_id;
+	in[nin++] = prep2_pld;
+	if (pdnode_stale(&pd_timing, nin, in, force)) {
+
+		/* calculate minimum echo time and esp, and corresponding deadtimes */
+		minesp = 0;
+		minte = 0;
+		switch (ro_type) {
+			case 1: /* FSE */
 			
-			/* calculate minimum esp (time from rf1 to next rf1) */
-			minesp += pw_gzrf1/2 + pw_gzrf1d; /* 2nd half of rf1 pulse */
-			minesp += pgbuffertime;
-			minesp += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* post-rf crusher */
-			minesp += pgbuffertime;
-			minesp += TIMESSI; /* inter-core time */
-			minesp += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
-			minesp += pgbuffertime;
-			minesp += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z encode gradient */
-			minesp += pw_gxw; /* spiral readout */
-			minesp += pgbuffertime;
-			minesp += (spi_mode == 0) * (pw_gzw2a + pw_gzw2 + pw_gzw2d + pgbuffertime); /* z rewind gradient */
-			minesp += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* for symmetry - add length of fc pre-phaser */
-			minesp += TIMESSI; /* inter-core time */
-			minesp += pgbuffertime;
-			minesp += pw_gzrf1trap1a + pw_gzrf1trap1 + pw_gzrf1trap1d; /* pre-rf crusher */
-			minesp += pgbuffertime;
-			minesp += pw_gzrf1a + pw_gzrf1; /* 1st half of rf1 pulse */
-
-			/* calculate minimum TE (time from center of rf0 to center of readout pulse) */
-			minte += pw_gzrf0/2 + pw_gzrf0d; /* 2nd half of rf0 pulse */
-			minte += pgbuffertime;
-			minte += pw_gzrf0ra + pw_gzrf0r + pw_gzrf0rd; /* rf0 slice select rewinder */
-			minte += pgbuffertime;
-			minte += TIMESSI; /* inter-core time */
-			minte += pgbuffertime;	
-			minte += pw_gzrf1trap1a + pw_gzrf1trap1 + pw_gzrf1trap1d; /* pre-rf crusher */
-			minte += pgbuffertime;
-			minte += pw_gzrf1a + pw_gzrf1 + pw_gzrf1d; /* rf1 pulse */
-			minte += pgbuffertime;	
-			minte += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* post-rf crusher */
-			minte += pgbuffertime;
-			minte += TIMESSI; /* inter-core time */
-			minte += pgbuffertime;
-			minte += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
-			minte += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
-			minte += pw_gxw/2; /* first half of spiral readout */
-
-			/* calculate deadtimes */
-			deadtime1_seqcore = (opte - minesp)/2;
-			deadtime1_seqcore -= (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* adjust for flowcomp symmetry */
-			minte += deadtime1_seqcore;
-			deadtime2_seqcore = (opte - minesp)/2;
-			deadtime2_seqcore += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime);		
-			deadtime_rf0core = opte - minte;
-
-			minte = (int)fmax(minte, minesp);
-			minesp = 0; /* no restriction on esp cv - let opte control the echo spacing */
+				/* calculate minimum esp (time from rf1 to next rf1) */
+				minesp += pw_gzrf1/2 + pw_gzrf1d; /* 2nd half of rf1 pulse */
+				minesp += pgbuffertime;
+				minesp += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* post-rf crusher */
+				minesp += pgbuffertime;
+				minesp += TIMESSI; /* inter-core time */
+				minesp += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
+				minesp += pgbuffertime;
+				minesp += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z encode gradient */
+				minesp += pw_gxw; /* spiral readout */
+				minesp += pgbuffertime;
+				minesp += (spi_mode == 0) * (pw_gzw2a + pw_gzw2 + pw_gzw2d + pgbuffertime); /* z rewind gradient */
+				minesp += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* for symmetry - add length of fc pre-phaser */
+				minesp += TIMESSI; /* inter-core time */
+				minesp += pgbuffertime;
+				minesp += pw_gzrf1trap1a + pw_gzrf1trap1 + pw_gzrf1trap1d; /* pre-rf crusher */
+				minesp += pgbuffertime;
+				minesp += pw_gzrf1a + pw_gzrf1; /* 1st half of rf1 pulse */
+
+				/* calculate minimum TE (time from center of rf0 to center of readout pulse) */
+				minte += pw_gzrf0/2 + pw_gzrf0d; /* 2nd half of rf0 pulse */
+				minte += pgbuffertime;
+				minte += pw_gzrf0ra + pw_gzrf0r + pw_gzrf0rd; /* rf0 slice select rewinder */
+				minte += pgbuffertime;
+				minte += TIMESSI; /* inter-core time */
+				minte += pgbuffertime;	
+				minte += pw_gzrf1trap1a + pw_gzrf1trap1 + pw_gzrf1trap1d; /* pre-rf crusher */
+				minte += pgbuffertime;
+				minte += pw_gzrf1a + pw_gzrf1 + pw_gzrf1d; /* rf1 pulse */
+				minte += pgbuffertime;	
+				minte += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* post-rf crusher */
+				minte += pgbuffertime;
+				minte += TIMESSI; /* inter-core time */
+				minte += pgbuffertime;
+				minte += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
+				minte += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
+				minte += pw_gxw/2; /* first half of spiral readout */
+
+				/* calculate deadtimes */
+				deadtime1_seqcore = (opte - minesp)/2;
+				deadtime1_seqcore -= (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* adjust for flowcomp symmetry */
+				minte += deadtime1_seqcore;
+				deadtime2_seqcore = (opte - minesp)/2;
+				deadtime2_seqcore += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime);		
+				deadtime_rf0core = opte - minte;
+
+				minte = (int)fmax(minte, minesp);
+				minesp = 0; /* no restriction on esp cv - let opte control the echo spacing */
 	
-			break;
+				break;
 
-		case 2: /* SPGR */
+			case 2: /* SPGR */
 			
-			/* calculate minimum esp (time from rf1 to next rf1) */
-			minesp += pw_gzrf1/2 + pw_gzrf1d; /* 2nd half of rf1 pulse */
-			minesp += pgbuffertime;
-			minesp += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* rf1 slice select rewinder */
-			minesp += pgbuffertime;
-			minesp += TIMESSI; /* inter-core time */
-			minesp += pgbuffertime;
-			minesp += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
-			minesp += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
-			minesp += pw_gxw; /* spiral readout */
-			minesp += pgbuffertime;
-			minesp += (spi_mode > 0) * (pw_gzw2a + pw_gzw2 + pw_gzw2d + pgbuffertime); /* z rewind gradient */
-			minesp += TIMESSI; /* inter-core time */
-			minesp += pgbuffertime;
-			minesp += pw_gzrf1trap1a + pw_gzrf1trap1 + pw_gzrf1trap1d; /* pre-rf crusher */
-			minesp += pgbuffertime;
-			minesp += pw_gzrf1a + pw_gzrf1; /* 1st half of rf1 pulse */
-
-			/* calculate minimum TE (time from center of rf1 to beginning of readout pulse) */
-			minte += pw_gzrf1/2 + pw_gzrf1d; /* 2nd half of rf1 pulse */
-			minte += pgbuffertime;	
-			minte += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* post-rf crusher */
-			minte += pgbuffertime;
-			minte += TIMESSI; /* inter-core time */
-			minte += pgbuffertime;
-			minte += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
-			minte += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
-
-			/* calculate deadtimes */
-			deadtime_rf0core = 1ms; /* no effect here */
-			deadtime1_seqcore = opte - minte;
-			minesp += deadtime1_seqcore; /* add deadtime1 to minesp calculation */
-			deadtime2_seqcore = esp - minesp;
+				/* calculate minimum esp (time from rf1 to next rf1) */
+				minesp += pw_gzrf1/2 + pw_gzrf1d; /* 2nd half of rf1 pulse */
+				minesp += pgbuffertime;
+				minesp += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* rf1 slice select rewinder */
+				minesp += pgbuffertime;
+				minesp += TIMESSI; /* inter-core time */
+				minesp += pgbuffertime;
+				minesp += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
+				minesp += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
+				minesp += pw_gxw; /* spiral readout */
+				minesp += pgbuffertime;
+				minesp += (spi_mode > 0) * (pw_gzw2a + pw_gzw2 + pw_gzw2d + pgbuffertime); /* z rewind gradient */
+				minesp += TIMESSI; /* inter-core time */
+				minesp += pgbuffertime;
+				minesp += pw_gzrf1trap1a + pw_gzrf1trap1 + pw_gzrf1trap1d; /* pre-rf crusher */
+				minesp += pgbuffertime;
+				minesp += pw_gzrf1a + pw_gzrf1; /* 1st half of rf1 pulse */
+
+				/* calculate minimum TE (time from center of rf1 to beginning of readout pulse) */
+				minte += pw_gzrf1/2 + pw_gzrf1d; /* 2nd half of rf1 pulse */
+				minte += pgbuffertime;	
+				minte += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* post-rf crusher */
+				minte += pgbuffertime;
+				minte += TIMESSI; /* inter-core time */
+				minte += pgbuffertime;
+				minte += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
+				minte += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
+
+				/* calculate deadtimes */
+				deadtime_rf0core = 1ms; /* no effect here */
+				deadtime1_seqcore = opte - minte;
+				minesp += deadtime1_seqcore; /* add deadtime1 to minesp calculation */
+				deadtime2_seqcore = esp - minesp;
 		
-			break;
+				break;
 
-		case 3: /* bSSFP */
+			case 3: /* bSSFP */
 
-			/* calculate minimum esp (time from rf1 to next rf1) */
-			minesp += pw_gzrf1/2 + pw_gzrf1d; /* 2nd half of rf1 pulse */
-			minesp += pgbuffertime;
-			minesp += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* rf1 slice select rewinder */
-			minesp += pgbuffertime;
-			minesp += TIMESSI; /* inter-core time */
-			minesp += pgbuffertime;
-			minesp += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
-			minesp += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
-			minesp += pw_gxw; /* spiral readout */
-			minesp += pgbuffertime;
-			minesp += pw_gzw2a + pw_gzw2 + pw_gzw2d; /* z rewind gradient */
-			minesp += TIMESSI; /* inter-core time */
-			minesp += pgbuffertime;
-			minesp += pw_gzrf1a + pw_gzrf1; /* 1st half of rf1 pulse */
-
-			/* calculate minimum TE (time from center of rf1 to beginning of readout pulse) */
-			minte += pw_gzrf1/2 + pw_gzrf1d; /* 2nd half of rf1 pulse */
-			minte += pgbuffertime;	
-			minte += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* post-rf crusher */
-			minte += pgbuffertime;
-			minte += TIMESSI; /* inter-core time */
-			minte += pgbuffertime;
-			minte += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
-			minte += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
-			minte += pw_gxw/2; /* first half of spiral readout */
+				/* calculate minimum esp (time from rf1 to next rf1) */
+				minesp += pw_gzrf1/2 + pw_gzrf1d; /* 2nd half of rf1 pulse */
+				minesp += pgbuffertime;
+				minesp += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* rf1 slice select rewinder */
+				minesp += pgbuffertime;
+				minesp += TIMESSI; /* inter-core time */
+				minesp += pgbuffertime;
+				minesp += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
+				minesp += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
+				minesp += pw_gxw; /* spiral readout */
+				minesp += pgbuffertime;
+				minesp += pw_gzw2a + pw_gzw2 + pw_gzw2d; /* z rewind gradient */
+				minesp += TIMESSI; /* inter-core time */
+				minesp += pgbuffertime;
+				minesp += pw_gzrf1a + pw_gzrf1; /* 1st half of rf1 pulse */
+
+				/* calculate minimum TE (time from center of rf1 to beginning of readout pulse) */
+				minte += pw_gzrf1/2 + pw_gzrf1d; /* 2nd half of rf1 pulse */
+				minte += pgbuffertime;	
+				minte += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d; /* post-rf crusher */
+				minte += pgbuffertime;
+				minte += TIMESSI; /* inter-core time */
+				minte += pgbuffertime;
+				minte += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime); /* flow comp pre-phaser */
+				minte += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
+				minte += pw_gxw/2; /* first half of spiral readout */
 			
-			/* calculate deadtimes */
-			deadtime_rf0core = 1ms; /* no effect here */
-			deadtime1_seqcore = opte - minte;
-			minesp += deadtime1_seqcore; /* add deadtime1 to minesp calculation */
-			deadtime2_seqcore = esp - minesp;
+				/* calculate deadtimes */
+				deadtime_rf0core = 1ms; /* no effect here */
+				deadtime1_seqcore = opte - minte;
+				minesp += deadtime1_seqcore; /* add deadtime1 to minesp calculation */
+				deadtime2_seqcore = esp - minesp;
 			
-			break;
-	}
-
-	/* set minimums */	
-	cvmin(esp, minesp);
-	cvmin(opte, minte);
-
-	/* set fatsup deadtime */
-	if (fatsup_mode < 2) /* CHESS/none */
-		deadtime_fatsupcore = 0;
-	else { /* SPIR */
-		deadtime_fatsupcore = spir_ti;
-		deadtime_fatsupcore -= pw_rffs/2; /* 2nd half of rf pulse */
-		deadtime_fatsupcore -= pgbuffertime;
-		deadtime_fatsupcore -= (pw_gzrffsspoila + pw_gzrffsspoil + pw_gzrffsspoild); /* crusher */
-		deadtime_fatsupcore -= pgbuffertime;
-		deadtime_fatsupcore -= TIMESSI;
-		deadtime_fatsupcore -= pgbuffertime;
-		switch (ro_type) {
-			case 1: /* FSE */
-				deadtime_fatsupcore -= (pw_gzrf0a + pw_gzrf0/2); /* first half of tipdown */
-				break;
-			case 2: /* SPGR */
-				deadtime_fatsupcore -= (pw_gzrf1trap1a + pw_gzrf1trap1 + pw_gzrf1trap2);
-				deadtime_fatsupcore -= pgbuffertime;
-				deadtime_fatsupcore -= (pw_gzrf1a + pw_gzrf1/2);
-				break;
-			case 3: /* bSSFP */
-				deadtime_fatsupcore -= (pw_gzrf1a + pw_gzrf1/2);
 				break;
 		}
+
+		/* set fatsup deadtime */
+		if (fatsup_mode < 2) /* CHESS/none */
+			deadtime_fatsupcore = 0;
+		else { /* SPIR */
+			deadtime_fatsupcore = spir_ti;
+			deadtime_fatsupcore -= pw_rffs/2; /* 2nd half of rf pulse */
+			deadtime_fatsupcore -= pgbuffertime;
+			deadtime_fatsupcore -= (pw_gzrffsspoila + pw_gzrffsspoil + pw_gzrffsspoild); /* crusher */
+			deadtime_fatsupcore -= pgbuffertime;
+			deadtime_fatsupcore -= TIMESSI;
+			deadtime_fatsupcore -= pgbuffertime;
+			switch (ro_type) {
+				case 1: /* FSE */
+					deadtime_fatsupcore -= (pw_gzrf0a + pw_gzrf0/2); /* first half of tipdown */
+					break;
+				case 2: /* SPGR */
+					deadtime_fatsupcore -= (pw_gzrf1trap1a + pw_gzrf1trap1 + pw_gzrf1trap2);
+					deadtime_fatsupcore -= pgbuffertime;
+					deadtime_fatsupcore -= (pw_gzrf1a + pw_gzrf1/2);
+					break;
+				case 3: /* bSSFP */
+					deadtime_fatsupcore -= (pw_gzrf1a + pw_gzrf1/2);
+					break;
+			}
+		}
+
+		/* Calculate the duration of presatcore */
+		dur_presatcore = 0;
+		dur_presatcore += pgbuffertime;
+		dur_presatcore += pw_rfps1;
+		dur_presatcore += pgbuffertime;
+		dur_presatcore += pw_rfps1ca + pw_rfps1c + pw_rfps1cd;
+		dur_presatcore += 1000 + pgbuffertime;
+		dur_presatcore += pw_rfps2;
+		dur_presatcore += pgbuffertime;
+		dur_presatcore += pw_rfps2ca + pw_rfps2c + pw_rfps2cd;
+		dur_presatcore += 1000 + pgbuffertime;
+		dur_presatcore += pw_rfps3;
+		dur_presatcore += pgbuffertime;
+		dur_presatcore += pw_rfps3ca + pw_rfps3c + pw_rfps3cd;
+		dur_presatcore += 1000 + pgbuffertime;
+		dur_presatcore += pw_rfps4;
+		dur_presatcore += pgbuffertime;
+		dur_presatcore += pw_rfps4ca + pw_rfps4c + pw_rfps4cd;
+		dur_presatcore += pgbuffertime;
+
+		/* Calcualte the duration of prep1core */
+		dur_prep1core = 0;
+		dur_prep1core += pgbuffertime;
+		dur_prep1core += GRAD_UPDATE_TIME*prep1_len;
+		dur_prep1core += pgbuffertime;
+
+		/* Calculate the duration of prep2core */
+		dur_prep2core = 0;
+		dur_prep2core += pgbuffertime;
+		dur_prep2core += GRAD_UPDATE_TIME*prep2_len;
+		dur_prep2core += pgbuffertime;
+
+		/* Calculate the duration of bkgsupcore */
+		dur_bkgsupcore = 0;
+		dur_bkgsupcore += pgbuffertime;
+		dur_bkgsupcore += pw_rfbs_rho;
+		dur_bkgsupcore += pgbuffertime;	
+
+		/* Calculate the duration of fatsupcore */
+		dur_fatsupcore = 0;
+		dur_fatsupcore += pgbuffertime;
+		dur_fatsupcore += pw_rffs;
+		dur_fatsupcore += pgbuffertime;
+		dur_fatsupcore += pw_gzrffsspoila + pw_gzrffsspoil + pw_gzrffsspoild;
+		dur_fatsupcore += pgbuffertime;
+		dur_fatsupcore += deadtime_fatsupcore;
+	
+		/* calculate duration of rf0core */
+		dur_rf0core = 0;
+		dur_rf0core += pgbuffertime;
+		dur_rf0core += pw_gzrf0a + pw_gzrf0 + pw_gzrf0d;
+		dur_rf0core += pgbuffertime;
+		dur_rf0core += pw_gzrf0ra + pw_gzrf0r + pw_gzrf0rd;
+		dur_rf0core += pgbuffertime; 
+		dur_rf0core += deadtime_rf0core;
+	
+		/* calculate duration of rf1core */
+		dur_rf1core = 0;
+		dur_rf1core += pgbuffertime;
+		dur_rf1core += pw_gzrf1trap1a + pw_gzrf1trap1 + pw_gzrf1trap1d;
+		dur_rf1core += pgbuffertime;
+		dur_rf1core += pw_gzrf1a + pw_gzrf1 + pw_gzrf1d;
+		dur_rf1core += pgbuffertime;
+		dur_rf1core += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d;
+		dur_rf1core += pgbuffertime; 
+
+		/* calculate duration of seqcore */
+		dur_seqcore = 0;
+		dur_seqcore += deadtime1_seqcore + pgbuffertime;
+		dur_seqcore += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime);
+		dur_seqcore += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
+		dur_seqcore += pw_gxw;
+		dur_seqcore += pgbuffertime;
+		dur_seqcore += pw_gzw2a + pw_gzw2 + pw_gzw2d;
+		dur_seqcore += pgbuffertime;
+		dur_seqcore += deadtime2_seqcore;
+
+		/* calculate minimum TR */
+		absmintr = presat_flag*(dur_presatcore + TIMESSI + presat_delay + TIMESSI);
+		absmintr += (prep1_id > 0)*(dur_prep1core + TIMESSI + prep1_pld + TIMESSI);
+		absmintr += (prep2_id > 0)*(dur_prep2core + TIMESSI + prep2_pld + TIMESSI);
+		absmintr += (fatsup_mode > 0)*(dur_fatsupcore + TIMESSI);
+		if (ro_type == 1) /* FSE - add the rf0 pulse */
+			absmintr += dur_rf0core + TIMESSI;
+		absmintr += (opetl + ndisdaqechoes) * (dur_rf1core + TIMESSI + dur_seqcore + TIMESSI);
+
+		pdcache_built(&pd_timing);
 	}
 
-	/* Calculate the duration of presatcore */
-	dur_presatcore = 0;
-	dur_presatcore += pgbuffertime;
-	dur_presatcore += pw_rfps1;
-	dur_presatcore += pgbuffertime;
-	dur_presatcore += pw_rfps1ca + pw_rfps1c + pw_rfps1cd;
-	dur_presatcore += 1000 + pgbuffertime;
-	dur_presatcore += pw_rfps2;
-	dur_presatcore += pgbuffertime;
-	dur_presatcore += pw_rfps2ca + pw_rfps2c + pw_rfps2cd;
-	dur_presatcore += 1000 + pgbuffertime;
-	dur_presatcore += pw_rfps3;
-	dur_presatcore += pgbuffertime;
-	dur_presatcore += pw_rfps3ca + pw_rfps3c + pw_rfps3cd;
-	dur_presatcore += 1000 + pgbuffertime;
-	dur_presatcore += pw_rfps4;
-	dur_presatcore += pgbuffertime;
-	dur_presatcore += pw_rfps4ca + pw_rfps4c + pw_rfps4cd;
-	dur_presatcore += pgbuffertime;
-
-	/* Calcualte the duration of prep1core */
-	dur_prep1core = 0;
-	dur_prep1core += pgbuffertime;
-	dur_prep1core += GRAD_UPDATE_TIME*prep1_len;
-	dur_prep1core += pgbuffertime;
-
-	/* Calculate the duration of prep2core */
-	dur_prep2core = 0;
-	dur_prep2core += pgbuffertime;
-	dur_prep2core += GRAD_UPDATE_TIME*prep2_len;
-	dur_prep2core += pgbuffertime;
-
-	/* Calculate the duration of bkgsupcore */
-	dur_bkgsupcore = 0;
-	dur_bkgsupcore += pgbuffertime;
-	dur_bkgsupcore += pw_rfbs_rho;
-	dur_bkgsupcore += pgbuffertime;	
-
-	/* Calculate the duration of fatsupcore */
-	dur_fatsupcore = 0;
-	dur_fatsupcore += pgbuffertime;
-	dur_fatsupcore += pw_rffs;
-	dur_fatsupcore += pgbuffertime;
-	dur_fatsupcore += pw_gzrffsspoila + pw_gzrffsspoil + pw_gzrffsspoild;
-	dur_fatsupcore += pgbuffertime;
-	dur_fatsupcore += deadtime_fatsupcore;
-	
-	/* calculate duration of rf0core */
-	dur_rf0core = 0;
-	dur_rf0core += pgbuffertime;
-	dur_rf0core += pw_gzrf0a + pw_gzrf0 + pw_gzrf0d;
-	dur_rf0core += pgbuffertime;
-	dur_rf0core += pw_gzrf0ra + pw_gzrf0r + pw_gzrf0rd;
-	dur_rf0core += pgbuffertime; 
-	dur_rf0core += deadtime_rf0core;
-	
-	/* calculate duration of rf1core */
-	dur_rf1core = 0;
-	dur_rf1core += pgbuffertime;
-	dur_rf1core += pw_gzrf1trap1a + pw_gzrf1trap1 + pw_gzrf1trap1d;
-	dur_rf1core += pgbuffertime;
-	dur_rf1core += pw_gzrf1a + pw_gzrf1 + pw_gzrf1d;
-	dur_rf1core += pgbuffertime;
-	dur_rf1core += pw_gzrf1trap2a + pw_gzrf1trap2 + pw_gzrf1trap2d;
-	dur_rf1core += pgbuffertime; 
-
-	/* calculate duration of seqcore */
-	dur_seqcore = 0;
-	dur_seqcore += deadtime1_seqcore + pgbuffertime;
-	dur_seqcore += (flowcomp_flag == 1 && spi_mode == 0)*(pw_gzfca + pw_gzfc + pw_gzfcd + pgbuffertime);
-	dur_seqcore += (spi_mode == 0) * (pw_gzw1a + pw_gzw1 + pw_gzw1d + pgbuffertime); /* z rewind gradient */
-	dur_seqcore += pw_gxw;
-	dur_seqcore += pgbuffertime;
-	dur_seqcore += pw_gzw2a + pw_gzw2 + pw_gzw2d;
-	dur_seqcore += pgbuffertime;
-	dur_seqcore += deadtime2_seqcore;
-
-	/* calculate minimum TR */
-	absmintr = presat_flag*(dur_presatcore + TIMESSI + presat_delay + TIMESSI);
-	absmintr += (prep1_id > 0)*(dur_prep1core + TIMESSI + prep1_pld + TIMESSI);
-	absmintr += (prep2_id > 0)*(dur_prep2core + TIMESSI + prep2_pld + TIMESSI);
-	absmintr += (fatsup_mode > 0)*(dur_fatsupcore + TIMESSI);
-	if (ro_type == 1) /* FSE - add the rf0 pulse */
-		absmintr += dur_rf0core + TIMESSI;
-	absmintr += (opetl + ndisdaqechoes) * (dur_rf1core + TIMESSI + dur_seqcore + TIMESSI);
+	/* set minimums */
+	cvmin(esp, minesp);
+	cvmin(opte, minte);
 	if (exist(opautotr) == PSD_MINIMUMTR)
 		optr = absmintr;	
 	cvmin(optr, absmintr);
@@ -1457,7 +1594,62 @@ STATUS predownload( void )
 	rhrcctrl = 1; /* bit 7 (2^7 = 128) skips all recon */
 	rhexecctrl = 2; /* bit 1 (2^1 = 2) sets autolock of raw files + bit 3 (2^3 = 8) transfers images to disk */
 
-	write_scan_info();
+	/* write out the scan info */
+	nin = 0;
+	in[nin++] = opfov;
+	in[nin++] = opslquant;
+	in[nin++] = opslthick;
+	in[nin++] = GMAX;
+	in[nin++] = SLEWMAX;
+	in[nin++] = ro_type;
+	in[nin++] = opflip;
+	in[nin++] = opte;
+	in[nin++] = esp;
+	in[nin++] = rfspoil_flag;
+	in[nin++] = optr;
+	in[nin++] = opetl;
+	in[nin++] = nframes;
+	in[nin++] = opnshots;
+	in[nin++] = narms;
+	in[nin++] = ndisdaqtrains;
+	in[nin++] = ndisdaqechoes;
+	in[nin++] = crushfac;
+	in[nin++] = flowcomp_flag;
+	in[nin++] = kill_grads;
+	in[nin++] = spi_mode;
+	in[nin++] = frame_rot;
+	in[nin++] = kz_acc;
+	in[nin++] = vds_acc0;
+	in[nin++] = vds_acc1;
+	in[nin++] = nnav;
+	in[nin++] = fatsup_mode;
+	in[nin++] = fatsup_off;
+	in[nin++] = fatsup_bw;
+	in[nin++] = spir_fa;
+	in[nin++] = spir_ti;
+	in[nin++] = prep1_id;
+	in[nin++] = prep1_pld;
+	in[nin++] = prep1_rfmax;
+	in[nin++] = prep1_gmax;
+	in[nin++] = prep1_mod;
+	in[nin++] = prep1_tbgs1;
+	in[nin++] = prep1_tbgs2;
+	in[nin++] = prep1_tbgs3;
+	in[nin++] = prep2_id;
+	in[nin++] = prep2_pld;
+	in[nin++] = prep2_rfmax;
+	in[nin++] = prep2_gmax;
+	in[nin++] = prep2_mod;
+	in[nin++] = prep2_tbgs1;
+	in[nin++] = prep2_tbgs2;
+	in[nin++] = prep2_tbgs3;
+	in[nin++] = presat_flag;
+	in[nin++] = presat_delay;
+	if (pdnode_stale(&pd_scaninfo, nin, in, force)) {
+		write_scan_info();
+		pdcache_built(&pd_scaninfo);
+	}
+	fprintf(stderr, "predownload(): rebuilt %d products (pdcache_rebuilt = %d)\n", pdcache_nrebuilt, pdcache_rebuilt);
 
 @inline Prescan.e PSpredownload	
 
@@ -2417,6 +2609,8 @@ STATUS scan( void )
 
 					/* Set the view transformation matrix */
 					rotidx = armn*opnshots*opetl + shotn*opetl + echon;
+					if (frame_rot) /* views are rotated frame-to-frame */
+						rotidx += framen*narms*opnshots*opetl;
 					if (kill_grads)
 						setrotate( zmtx, 0 );
 					else
@@ -2459,6 +2653,52 @@ void dummylinks( void )
 * Define the functions that will run on the host 
 * during predownload operations
 *****************************************************/
+int pdcache_setup() {
+
+	/* products that only depend on CVs */
+	pdnode_init(&pd_prep1, "prep1", PD_PREP1);
+	pdnode_init(&pd_prep2, "prep2", PD_PREP2);
+	pdnode_init(&pd_b1, "b1", PD_B1);
+	pdnode_init(&pd_crush, "crush", PD_CRUSH);
+	pdnode_init(&pd_zenc, "zenc", PD_ZENC);
+	pdnode_init(&pd_spiral, "spiral", PD_SPIRAL);
+	pdnode_init(&pd_views, "views", PD_VIEWS);
+
+	/* timing depends on the lengths of the waveforms and gradients */
+	pdnode_init(&pd_timing, "timing", PD_TIMING);
+	pdnode_addparent(&pd_timing, &pd_prep1);
+	pdnode_addparent(&pd_timing, &pd_prep2);
+	pdnode_addparent(&pd_timing, &pd_crush);
+	pdnode_addparent(&pd_timing, &pd_zenc);
+	pdnode_addparent(&pd_timing, &pd_spiral);
+
+	/* scan info reports the acquisition window length */
+	pdnode_init(&pd_scaninfo, "scaninfo", PD_SCANINFO);
+	pdnode_addparent(&pd_scaninfo, &pd_spiral);
+
+	return 1;
+}
+
+int pdcache_built(pdnode *node) {
+
+	pdnode_commit(node);
+	pdcache_rebuilt |= node->bit;
+	pdcache_nrebuilt++;
+	fprintf(stderr, "predownload(): rebuilt %s (build %d)\n", node->name, node->nbuilds);
+
+	return 1;
+}
+
+int settrap(trapgrad *trap, float *a, int *pwa, int *pw, int *pwd) {
+
+	*a = trap->a;
+	*pwa = trap->pwa;
+	*pw = trap->pw;
+	*pwd = trap->pwd;
+
+	return 1;
+}
+
 int genspiral() {
 
 	FILE *fID_ktraj = fopen("ktraj.txt", "w");
@@ -2603,7 +2843,7 @@ int genviews() {
 
 	/* Declare values and matrices */
 	FILE* fID_kviews = fopen("kviews.txt","w");
-	int rotidx, armn, shotn, echon, n;
+	int rotidx, framen, armn, shotn, echon, n;
 	float rz, theta, phi, dz;
 	float Rz[9], Rtheta[9], Rphi[9], Tz[9];
 	float T_0[9], T[9];
@@ -2615,58 +2855,61 @@ int genviews() {
         for (n = 0; n < 9; n++) T_0[n] = (float)rsprot[0][n] / MAX_PG_WAMP;
         orthonormalize(T_0, 3, 3);
 
-	/* Loop through all views */
-	for (armn = 0; armn < narms; armn++) {
-		for (shotn = 0; shotn < opnshots; shotn++) {
-			for (echon = 0; echon < opetl; echon++) {
-
-				/* calculate view index */
-				rotidx = armn*opnshots*opetl + shotn*opetl + echon;
-
-				/* Set the rotation angles and kz step (as a fraction of kzmax) */ 
-				rz = M_PI * (float)armn / (float)narms;
-				if (ro_type == 2) /* spiral out */
-					rz *= 2;	
-				phi = 0.0;
-				theta = 0.0;
-				dz = 0.0;
-				switch (spi_mode) {
-					case 0: /* SOS */
-						phi = 0.0;
-						theta = 0.0;
-						dz = 2.0/(float)opetl * (center_out_idx(opetl,echon) - 1.0/(float)opnshots*center_out_idx(opnshots,shotn)) - 1.0;
-						break;
-					case 1: /* 2D TGA */
-						phi = 0.0;
-						theta = phi2D * M_PI * (shotn*opetl + echon);
-						dz = 0.0;
-						break;
-					case 2: /* 3D TGA */
-						theta = acos(fmod(echon*phi3D_1, 1.0)); /* polar angle */
-						phi = 2.0*M_PI * fmod(echon*phi3D_2, 1.0); /* azimuthal angle */
-						dz = 0.0;
-						break;
-				}
+	/* Loop through all views (of all frames if frame_rot is on) */
+	for (framen = 0; framen < ((frame_rot) ? (nframes) : (1)); framen++) {
+		for (armn = 0; armn < narms; armn++) {
+			for (shotn = 0; shotn < opnshots; shotn++) {
+				for (echon = 0; echon < opetl; echon++) {
 
-				/* Calculate the transformation matrices */
-				Tz[8] = dz;
-				genrotmat('z', rz, Rz);
-				genrotmat('x', theta, Rtheta);
-				genrotmat('z', phi, Rphi);
-
-				/* Multiply the transformation matrices */
-				multmat(3,3,3,T_0,Tz,T); /* kz scale T = T_0 * Tz */
-				multmat(3,3,3,Rz,T,T); /* z rotation (arm-to-arm) T = Rz * T */
-				multmat(3,3,3,Rtheta,T,T); /* polar angle rotation T = Rtheta * T */
-				multmat(3,3,3,Rphi,T,T); /* azimuthal angle rotation T = Rphi * T */
-
-				/* Save the matrix to the table of matrices */
-				fprintf(fID_kviews, "%d \t%d \t%d \t%f \t%f \t", armn, shotn, echon, rz, dz);	
-				for (n = 0; n < 9; n++) {
-					fprintf(fID_kviews, "%f \t", T[n]);
-					tmtxtbl[rotidx][n] = (long)round(MAX_PG_WAMP*T[n]);
+					/* calculate view index */
+					rotidx = framen*narms*opnshots*opetl + armn*opnshots*opetl + shotn*opetl + echon;
+
+					/* Set the rotation angles and kz step (as a fraction of kzmax) */ 
+					rz = M_PI * (float)armn / (float)narms;
+					if (ro_type == 2) /* spiral out */
+						rz *= 2;
+					rz += 2.0*M_PI * (float)framen / (phi2D*phi2D); /* golden angle frame-to-frame rotation */
+					phi = 0.0;
+					theta = 0.0;
+					dz = 0.0;
+					switch (spi_mode) {
+						case 0: /* SOS */
+							phi = 0.0;
+							theta = 0.0;
+							dz = 2.0/(float)opetl * (center_out_idx(opetl,echon) - 1.0/(float)opnshots*center_out_idx(opnshots,shotn)) - 1.0;
+							break;
+						case 1: /* 2D TGA */
+							phi = 0.0;
+							theta = phi2D * M_PI * (shotn*opetl + echon);
+							dz = 0.0;
+							break;
+						case 2: /* 3D TGA */
+							theta = acos(fmod(echon*phi3D_1, 1.0)); /* polar angle */
+							phi = 2.0*M_PI * fmod(echon*phi3D_2, 1.0); /* azimuthal angle */
+							dz = 0.0;
+							break;
+					}
+
+					/* Calculate the transformation matrices */
+					Tz[8] = dz;
+					genrotmat('z', rz, Rz);
+					genrotmat('x', theta, Rtheta);
+					genrotmat('z', phi, Rphi);
+
+					/* Multiply the transformation matrices */
+					multmat(3,3,3,T_0,Tz,T); /* kz scale T = T_0 * Tz */
+					multmat(3,3,3,Rz,T,T); /* z rotation (arm-to-arm) T = Rz * T */
+					multmat(3,3,3,Rtheta,T,T); /* polar angle rotation T = Rtheta * T */
+					multmat(3,3,3,Rphi,T,T); /* azimuthal angle rotation T = Rphi * T */
+
+					/* Save the matrix to the table of matrices */
+					fprintf(fID_kviews, "%d \t%d \t%d \t%f \t%f \t", armn, shotn, echon, rz, dz);	
+					for (n = 0; n < 9; n++) {
+						fprintf(fID_kviews, "%f \t", T[n]);
+						tmtxtbl[rotidx][n] = (long)round(MAX_PG_WAMP*T[n]);
+					}
+					fprintf(fID_kviews, "\n");
 				}
-				fprintf(fID_kviews, "\n");
 			}
 		}
 	}
@@ -2870,6 +3113,7 @@ int write_scan_info() {
 				fprintf(finfo, "\t%-50s%20s\n", "Projection mode:", "3DTGA");
 				break;
 		}
+		fprintf(finfo, "\t%-50s%20s\n", "Frame view rotation:", (frame_rot) ? ("golden angle") : ("off"));
 		fprintf(finfo, "\t%-50s%20f\n", "VDS center acceleration factor:", vds_acc0);
 		fprintf(finfo, "\t%-50s%20f\n", "VDS edge acceleration factor:", vds_acc1);
 		fprintf(finfo, "\t%-50s%20d\n", "Number of navigator points:", nnav);
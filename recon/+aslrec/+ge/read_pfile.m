@@ -1,6 +1,11 @@
-function [data,hdr] = read_pfile(searchstr)
+function [data,hdr] = read_pfile(searchstr, hdronly)
 % Function to read pfile using orchestra functions
 % by David Frey
+%
+% Data are returned as complex integers in the native point size of the
+%   pfile (int16 or int32) to keep memory low, convert them to single or
+%   double where they are used. Set hdronly to only read the headers (data
+%   is returned empty).
 
     % import all ge functions
     import aslrec.ge.*
@@ -9,6 +14,9 @@ function [data,hdr] = read_pfile(searchstr)
     if nargin < 1 || isempty(searchstr)
         searchstr = 'P*.7';
     end
+    if nargin < 2
+        hdronly = 0;
+    end
 
     % Find Pfile based on search string
     dirp = dir(searchstr);
@@ -17,7 +25,7 @@ function [data,hdr] = read_pfile(searchstr)
         h = cell(size(dirp,1),1);
         for n = 1:size(dirp,1) % Recurse through all pfiles
              pfile = [dirp(1).folder '/' dirp(1).name];
-             [data_i,h_i] = read_pfile(pfile);
+             [data_i,h_i] = read_pfile(pfile,hdronly);
              data{n} = data_i;
              h{n} = h_i;
         end
@@ -72,6 +80,13 @@ function [data,hdr] = read_pfile(searchstr)
        end
        hdr.grad = read_grad_header(fid,rdbm_rev);
     end
+
+    % Return the headers only
+    if hdronly
+        data = [];
+        fclose(fid);
+        return
+    end
     
     % Get data sizes from rbd header
     ndat = hdr.rdb.frame_size;
@@ -85,8 +100,8 @@ function [data,hdr] = read_pfile(searchstr)
     
     % Read in data
     fseek(fid, hdr.rdb.off_data, 'bof');
-    data = double(fread(fid, Inf, precision));
-    data = data(1:2:end) + 1i*data(2:2:end);
+    data = fread(fid, [2,Inf], precision);
+    data = complex(data(1,:), data(2,:));
     data = reshape(data,ndat,nviews+1,nslices,nechoes,ncoils);
     data = data(:,2:end,:,:,:); % Cut out the baseline
 
@@ -0,0 +1,56 @@
+function [op, stats] = buildop(klocs,N,fov,stats,kmsk,w)
+% Function to build the NUFFT system operator and density compensation
+%   weights for a umvsasl trajectory. The operator only depends on the
+%   trajectory and image size, so it can be reused across frames and
+%   across exams with the same protocol.
+%
+% by David Frey
+%
+% Arguments:
+%   - klocs: kspace locations [nsamp x nviews x 3] (of a single frame if
+%       the views are rotated across frames)
+%   - N: image size
+%   - fov: field of view (cm)
+%   - stats: stage statistics structure to append nufft and dcf stages to
+%       (optional, see aslrec.logstage)
+%   - kmsk: mask of samples to use [nsamp x nviews] (optional, see
+%       aslrec.prepdata)
+%   - w: precomputed density compensation weights for the same klocs and
+%       kmsk (optional, i.e. computed once on the client and shipped to
+%       workers), leave empty to calculate them
+%
+% Output:
+%   - op: structure containing the NUFFT (A), density compensation (w),
+%       mask of used samples inside the nufft bandwidth (msk), and image
+%       size (N)
+%
+
+    if nargin < 4
+        stats = [];
+    end
+    if nargin < 5 || isempty(kmsk)
+        kmsk = true(size(klocs,1),size(klocs,2));
+    end
+    if nargin < 6
+        w = [];
+    end
+
+    % set nufft arguments
+    nufft_args = {N, 6*ones(1,3), 2*N, N/2, 'table', 2^10, 'minmax:kb'};
+
+    % calculate a new system operator
+    t0 = tic;
+    omega = 2*pi*fov(:)'./N(:)'.*reshape(klocs,[],3);
+    op.msk = (vecnorm(omega,2,2) < pi) & kmsk(:);
+    op.A = Gnufft(true(N),[omega(op.msk,:),nufft_args]); % NUFFT
+    op.N = N;
+    stats = aslrec.logstage(stats, 'nufft', t0);
+    if isempty(w)
+        t0 = tic;
+        op.w = aslrec.pipedcf(op.A,3); % calculate density compensation
+        stats = aslrec.logstage(stats, 'dcf', t0);
+    else
+        op.w = w;
+    end
+
+end
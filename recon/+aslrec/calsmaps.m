@@ -0,0 +1,138 @@
+function smap = calsmaps(kdata,klocs,N,fov,varargin)
+% Function to estimate coil sensitivity maps directly from the center of
+%   the spiral kspace data (navigator + low resolution spiral samples)
+%   using the eigenvector method of Walsh, D.O., et al. (2000) Adaptive
+%   reconstruction of phased array MR imagery, Magn. Reson. Med.
+%   43(5):682-690, https://doi.org/10.1002/(SICI)1522-2594(200005)43:5<682::AID-MRM10>3.0.CO;2-G
+%
+% by David Frey
+%
+% Required paths:
+%   - MIRT (git@github.com:JeffFessler/mirt.git)
+%
+% Low resolution coil images are gridded from all samples inside the
+%   calibration radius, then the dominant eigenvector of the local coil
+%   covariance matrix is found at every voxel at once (vectorized power
+%   iteration) and interpolated up to the image size.
+%
+% Arguments:
+%   - kdata: kspace data [nsamp x nviews x nframes x ncoils], as returned
+%       by aslrec.read_data
+%   - klocs: kspace locations [nsamp x nviews x 3 x nkframes] (if the
+%       views are rotated across frames, the calibration samples of all
+%       frames are gridded together instead of averaging the frames)
+%   - N: image size
+%   - fov: field of view (cm)
+%   - ncal: calibration matrix size (calibration radius = ncal/fov/2)
+%   - ksize: size of the local covariance window (voxels)
+%   - niter: number of power iterations
+%   - frames: frames to average for calibration (default is all frames)
+%   - fidx: indicies of the acquired frames in kdata (default is all,
+%       see aslrec.prepdata), frames index into fidx
+%   - thresh: mask out voxels with low resolution rss below thresh*max
+%       (0 for no mask)
+%   - kmsk: mask of samples to use [nsamp x nviews] (default is all)
+%
+% Output:
+%   - smap: sensitivity maps [image size x ncoils], same layout as
+%       recon3dflex expects
+%
+
+    % set defaults
+    defaults.ncal = 24;
+    defaults.ksize = 5;
+    defaults.niter = 20;
+    defaults.frames = [];
+    defaults.thresh = 0;
+    defaults.kmsk = [];
+    defaults.fidx = [];
+
+    % parse input parameters
+    args = vararg_pair(defaults,varargin);
+    if isempty(args.fidx)
+        args.fidx = 1:size(kdata,3);
+    end
+    if isempty(args.frames)
+        args.frames = 1:length(args.fidx);
+    end
+    if isempty(args.kmsk)
+        args.kmsk = true(size(kdata,1),size(kdata,2));
+    end
+    ncoils = size(kdata,4);
+    Ncal = args.ncal * ones(1,3);
+
+    % select the calibration samples of each set of views
+    nkframes = size(klocs,4);
+    if nkframes > 1
+        kframes = args.frames;
+    else
+        kframes = 1;
+    end
+    omega = [];
+    kr = [];
+    b = [];
+    for kframen = kframes
+        omega_n = 2*pi*fov(:)'./Ncal.*reshape(klocs(:,:,:,kframen),[],3);
+        kr_n = vecnorm(omega_n,2,2) / pi;
+        omega_msk = (kr_n < 1) & args.kmsk(:);
+        if nkframes > 1 % views differ across frames, keep the samples of each frame
+            b_n = aslrec.getframe(kdata,args.fidx(kframen),omega_msk);
+        else % same views for all frames, average the frames
+            b_n = zeros(sum(omega_msk),ncoils,'single');
+            for framen = args.frames
+                b_n = b_n + aslrec.getframe(kdata,args.fidx(framen),omega_msk) / length(args.frames);
+            end
+        end
+        omega = [omega; omega_n(omega_msk,:)]; %#ok<AGROW>
+        kr = [kr; kr_n(omega_msk)]; %#ok<AGROW>
+        b = [b; b_n]; %#ok<AGROW>
+    end
+    fprintf('calsmaps: gridding %d calibration samples to %d^3...\n', ...
+        size(omega,1), args.ncal);
+
+    % grid low resolution coil images with a hann taper
+    b = double(b) .* (0.5 + 0.5*cos(pi*kr));
+    A = Gnufft(true(Ncal),{omega, Ncal, 6*ones(1,3), 2*Ncal, Ncal/2, ...
+        'table', 2^10, 'minmax:kb'});
+    w = aslrec.pipedcf(A,5);
+    img = reshape(A' * (w.*b), [], ncoils); % [nvox x ncoils]
+    nvox = size(img,1);
+
+    % calculate the local coil covariance matrices [nvox x ncoils x ncoils]
+    R = reshape(img,[],ncoils,1) .* reshape(conj(img),[],1,ncoils); % R(:,i,j) = img_i*conj(img_j)
+    R = reshape(convn(reshape(R,[Ncal,ncoils^2]), ...
+        ones(args.ksize*ones(1,3))/args.ksize^3, 'same'), nvox, ncoils, ncoils);
+
+    % find the dominant eigenvector at every voxel with power iterations
+    v = img ./ max(vecnorm(img,2,2), eps);
+    for n = 1:args.niter
+        v = squeeze(sum(R .* reshape(v,nvox,1,ncoils), 3)); % v = R*v
+        v = v ./ max(vecnorm(v,2,2), eps);
+    end
+    clear R
+
+    % reference the phase to the 1st coil
+    v = v .* exp(-1i*angle(v(:,1)));
+
+    % mask the background
+    if args.thresh > 0
+        rss = vecnorm(img,2,2);
+        v(rss < args.thresh*max(rss), :) = 0;
+    end
+
+    % interpolate maps up to the image size
+    fprintf('calsmaps: interpolating %d maps to %dx%dx%d...\n', ncoils, N);
+    xc = cell(1,3);
+    xq = cell(1,3);
+    for i = 1:3 % voxel locations (cm)
+        xc{i} = ((0:Ncal(i)-1) - Ncal(i)/2) * fov(i)/Ncal(i);
+        xq{i} = ((0:N(i)-1) - N(i)/2) * fov(i)/N(i);
+    end
+    v = reshape(v,[Ncal,ncoils]);
+    smap = zeros([N(:)',ncoils]);
+    for coiln = 1:ncoils
+        F = griddedInterpolant(xc, v(:,:,:,coiln), 'linear', 'nearest');
+        smap(:,:,:,coiln) = F(xq);
+    end
+
+end
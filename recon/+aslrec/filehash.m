@@ -0,0 +1,29 @@
+function h = filehash(files, vals)
+% Function to compute an MD5 hash of the contents of a list of files, used
+%   to identify exams with identical trajectories/protocols
+%
+% by David Frey
+%
+% Arguments:
+%   - files: cell array of file names
+%   - vals: numeric values to include in the hash (optional)
+%
+% Output:
+%   - h: hex string of the MD5 hash of the concatenated file contents
+%
+
+    md = java.security.MessageDigest.getInstance('MD5');
+    for n = 1:length(files)
+        fid = fopen(files{n},'r');
+        if fid < 0
+            error('could not open %s', files{n});
+        end
+        md.update(fread(fid, Inf, 'uint8=>int8'));
+        fclose(fid);
+    end
+    if nargin > 1
+        md.update(typecast(double(vals(:)),'int8'));
+    end
+    h = lower(reshape(dec2hex(typecast(md.digest(),'uint8'))',1,[]));
+
+end
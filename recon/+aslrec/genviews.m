@@ -0,0 +1,103 @@
+function kviews = genviews(varargin)
+% Function to generate the table of view transformation matrices, ported
+%   from genviews() in umvsasl.e (with the prescribed orientation taken to
+%   be the identity)
+%
+% by David Frey
+%
+% Arguments:
+%   - narms: number of spiral arms
+%   - nshots: number of shots (opnshots)
+%   - etl: echo train length (opetl)
+%   - ro_type: FSE (1), SPGR (2), or bSSFP (3)
+%   - spi_mode: SOS (0), TGA (1), or 3DTGA (2)
+%   - nframes: number of frames
+%   - frame_rot: option to rotate the views of each frame by the golden
+%       angle (same as frame_rot in umvsasl.e)
+%
+% Output:
+%   - kviews: table in the same format as kviews.txt, with rows
+%       [armn, shotn, echon, rz, dz, T(1,:), T(2,:), T(3,:)], repeated
+%       for each frame if frame_rot is on
+%
+
+    % set defaults
+    defaults.narms = 1;
+    defaults.nshots = 1;
+    defaults.etl = 16;
+    defaults.ro_type = 2;
+    defaults.spi_mode = 0;
+    defaults.nframes = 1;
+    defaults.frame_rot = 0;
+
+    % parse input parameters
+    args = vararg_pair(defaults, varargin);
+
+    % golden ratio numbers
+    phi2D = (1 + sqrt(5)) / 2;
+    phi3D_1 = 0.4656;
+    phi3D_2 = 0.6823;
+
+    % loop through all views (of all frames if frame_rot is on)
+    nkframes = 1 + (args.nframes - 1) * (args.frame_rot > 0);
+    kviews = zeros(nkframes*args.narms*args.nshots*args.etl, 14);
+    for framen = 0:nkframes-1
+    for armn = 0:args.narms-1
+        for shotn = 0:args.nshots-1
+            for echon = 0:args.etl-1
+
+                % calculate view index
+                rotidx = framen*args.narms*args.nshots*args.etl + ...
+                    armn*args.nshots*args.etl + shotn*args.etl + echon;
+
+                % set the rotation angles and kz step (as a fraction of kzmax)
+                rz = pi * armn / args.narms;
+                if args.ro_type == 2 % spiral out
+                    rz = 2*rz;
+                end
+                rz = rz + 2*pi * framen / phi2D^2; % golden angle frame-to-frame rotation
+                phi = 0;
+                theta = 0;
+                dz = 0;
+                switch args.spi_mode
+                    case 0 % SOS
+                        dz = 2/args.etl * (center_out_idx(args.etl,echon) - ...
+                            1/args.nshots*center_out_idx(args.nshots,shotn)) - 1;
+                    case 1 % 2D TGA
+                        theta = phi2D * pi * (shotn*args.etl + echon);
+                    case 2 % 3D TGA
+                        theta = acos(mod(echon*phi3D_1, 1));
+                        phi = 2*pi * mod(echon*phi3D_2, 1);
+                end
+
+                % multiply the transformation matrices
+                Tz = diag([1, 1, dz]);
+                T = genrotmat('z',phi) * genrotmat('x',theta) * genrotmat('z',rz) * Tz;
+
+                % save the matrix to the table
+                kviews(rotidx+1,:) = [armn, shotn, echon, rz, dz, reshape(T',1,[])];
+
+            end
+        end
+    end
+    end
+
+end
+
+function R = genrotmat(axis, angle)
+    switch axis
+        case 'x'
+            R = [1, 0, 0; 0, cos(angle), -sin(angle); 0, sin(angle), cos(angle)];
+        case 'z'
+            R = [cos(angle), -sin(angle), 0; sin(angle), cos(angle), 0; 0, 0, 1];
+    end
+end
+
+function idx = center_out_idx(len, idx)
+    center = floor(len/2);
+    if mod(idx,2)
+        idx = center + floor((idx+1)/2);
+    else
+        idx = center - idx/2;
+    end
+end
@@ -0,0 +1,25 @@
+function b = getframe(kdata,framen,kmsk,ccmat)
+% Function to extract a single frame of kspace data for recon as complex
+%   single precision, keeping only the masked samples and applying coil
+%   compression. Only the requested frame is converted from the native
+%   precision of kdata.
+%
+% by David Frey
+%
+% Arguments:
+%   - kdata: kspace data [nsamp x nviews x nframes x ncoils]
+%   - framen: frame index
+%   - kmsk: mask of samples to keep [nsamp x nviews]
+%   - ccmat: coil compression matrix [ncoils x compressed ncoils] (optional)
+%
+% Output:
+%   - b: frame data [sum(kmsk(:)) x ncoils]
+%
+
+    b = reshape(kdata(:,:,framen,:),[],size(kdata,4));
+    b = single(b(kmsk,:));
+    if nargin > 3 && ~isempty(ccmat)
+        b = b*ccmat;
+    end
+
+end
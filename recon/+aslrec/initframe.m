@@ -0,0 +1,42 @@
+function x0 = initframe(A, w, b, N, msg_pfx, reduce)
+% Function to calculate the density compensated adjoint solution of a
+%   single frame, scaled to the data, as the initial solution for CG
+%   (aslrec.reconframe)
+%
+% by David Frey
+%
+% Arguments:
+%   - A: system operator (NUFFT, or Asense for multiple coils)
+%   - w: density compensation weights
+%   - b: kspace data for the frame [nsamp x ncoils]
+%   - N: image size
+%   - msg_pfx: prefix for output messages
+%   - reduce: function to sum partial results over a coil partition of the
+%       operator (see aslrec.reconframe), leave empty for a single operator
+%
+% Output:
+%   - x0: initial solution (double precision)
+%
+
+    % set default message prefix
+    if nargin < 5
+        msg_pfx = '';
+    end
+    if nargin < 6
+        reduce = [];
+    end
+
+    % initialize with density compensated adjoint solution
+    b = double(b);
+    fprintf("%sinitializing solution x0 = A'*(w.*b)\n", msg_pfx)
+    if isempty(reduce)
+        x0 = reshape( A' * (w.*b), N );
+        x0 = ir_wls_init_scale(A, b, x0);
+    else % sum the adjoint and the least squares scale over the partition
+        x0 = reduce( reshape( A' * (w.*b), N ) );
+        Ax0 = A * x0;
+        s = reduce( [real(Ax0(:)' * b(:)); norm(Ax0(:))^2] );
+        x0 = s(1) / s(2) * x0;
+    end
+
+end
@@ -0,0 +1,17 @@
+function stats = logstage(stats, name, tstart)
+% Function to record the elapsed time and memory usage of a recon stage
+%
+% by David Frey
+%
+% Arguments:
+%   - stats: stage statistics structure to append to (can be empty)
+%   - name: name of the stage
+%   - tstart: tic value from the beginning of the stage
+%
+
+    [rss, peakrss] = aslrec.memstat();
+    stats.(name) = struct('time', toc(tstart), 'rss', rss, 'peakrss', peakrss);
+    fprintf('%s: %.3f s, rss = %.1f MB, peak rss = %.1f MB\n', ...
+        name, stats.(name).time, rss, peakrss);
+
+end
@@ -0,0 +1,29 @@
+function [rss, peakrss] = memstat()
+% Function to get the current and peak resident memory of the MATLAB
+%   process (MB), read from /proc/self/status (linux only)
+%
+% by David Frey
+%
+
+    rss = NaN;
+    peakrss = NaN;
+
+    % read the process status file
+    fid = fopen('/proc/self/status','r');
+    if fid < 0
+        return % not available on this platform
+    end
+    txt = fread(fid, Inf, 'char=>char')';
+    fclose(fid);
+
+    % parse the resident set sizes (kB)
+    tok = regexp(txt, 'VmRSS:\s*(\d+)', 'tokens', 'once');
+    if ~isempty(tok)
+        rss = str2double(tok{1}) / 1024;
+    end
+    tok = regexp(txt, 'VmHWM:\s*(\d+)', 'tokens', 'once');
+    if ~isempty(tok)
+        peakrss = str2double(tok{1}) / 1024;
+    end
+
+end
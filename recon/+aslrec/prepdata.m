@@ -0,0 +1,113 @@
+function [kdata,klocs,N,fov,smap,stats,kmsk,ccmat,fidx] = prepdata(varargin)
+% Function to read umvsasl data and prepare it for recon: masks out the
+%   leading samples, estimates sensitivity maps if requested, and computes
+%   the coil compression matrix to match the sensitivity maps
+%
+% by David Frey
+%
+% kdata is returned untouched in its native precision (see
+%   aslrec.read_data). Trimming, empty view removal and coil compression
+%   are not applied to it directly, instead the sample mask (kmsk) and
+%   compression matrix (ccmat) are applied one frame at a time with
+%   aslrec.getframe, and frames are read through the acquired frame
+%   indicies (fidx), so no full size copies of the data are made.
+%
+% Arguments:
+%   - pfile: pfile name search string (see aslrec.read_data)
+%   - smap: sensitivity map, [] or 'calib' (see recon3dflex)
+%   - coilwise: option to rearrange data for coil-wise recon of 1st frame
+%   - resfac: image space resolution upsampling factor
+%   - ccfac: coil compression factor
+%   - ntrim: number of leading samples of each view to discard
+%
+% Outputs:
+%   - kdata: kspace data [nsamp x nviews x nframes x ncoils]
+%   - klocs: kspace locations [nsamp x nviews x 3 x nkframes] (nkframes
+%       is the number of frames if the views are rotated across frames,
+%       otherwise 1)
+%   - N: image size
+%   - fov: field of view (cm)
+%   - smap: sensitivity map [image size x ncoils] (empty for 1 coil),
+%       compressed with ccmat
+%   - stats: read, smap and cc stage statistics (see aslrec.logstage)
+%   - kmsk: mask of samples to use [nsamp x nviews] (excludes the leading
+%       samples and empty views)
+%   - ccmat: coil compression matrix [ncoils x compressed ncoils] (empty
+%       for no compression)
+%   - fidx: indicies of the acquired frames in kdata (frame n of the scan
+%       is kdata(:,:,fidx(n),:))
+%
+
+    % set defaults
+    defaults.pfile = [];
+    defaults.smap = [];
+    defaults.coilwise = 0;
+    defaults.resfac = 1;
+    defaults.ccfac = 1;
+    defaults.ntrim = 50;
+    
+    % parse input parameters
+    args = vararg_pair(defaults,varargin);
+
+    % get data from pfile
+    stats = [];
+    t0 = tic;
+    [kdata,klocs,N,fov,vmsk,fidx] = aslrec.read_data(args.pfile);
+    if args.coilwise % rearrange for coil-wise reconstruction of frame 1 (for making SENSE maps)
+        kdata = permute(kdata(:,:,fidx(1),:),[1,2,4,3]);
+        klocs = klocs(:,:,:,1); % views of frame 1
+        fidx = 1:size(kdata,3);
+    end
+    N = ceil(N*args.resfac); % upsample N
+    
+    % mask out first ntrim pts of acquisition (sometimes gets corrupted)
+    kmsk = true(size(kdata,1),size(kdata,2));
+    kmsk(1:args.ntrim,:) = false;
+    kmsk(:,~vmsk) = false; % mask out empty views
+    stats = aslrec.logstage(stats, 'read', t0);
+    
+    % get sizes
+    nframes = length(fidx); % number of acquired frames
+    ncoils = size(kdata,4); % number of coils
+    
+    % estimate sensitivity maps from the center of kspace
+    if strcmpi(args.smap,'calib')
+        t0 = tic;
+        args.smap = aslrec.calsmaps(kdata,klocs,N,fov,'kmsk',kmsk,'fidx',fidx);
+        stats = aslrec.logstage(stats, 'smap', t0);
+    end
+    
+    % determine the number of compressed coils
+    t0 = tic;
+    ncc = ncoils;
+    if isempty(args.smap) && (ncoils > 1)
+        ncc = 1;
+        warning('sense map is empty, compressing data to 1 coil...');
+    elseif (args.ccfac > 1) && (size(args.smap,4) == ncoils)
+        ncc = ceil(ncoils/args.ccfac);
+        fprintf('compressing data & SENSE map to %d coils...\n', ncc);
+    elseif size(args.smap,4) < ncoils
+        ncc = size(args.smap,4);
+        warning('compressing data down to %d coils to match SENSE map...', ncc);
+    end
+    
+    % calculate the compression matrix from the coil covariance, one frame
+    %   at a time
+    ccmat = [];
+    if ncc < ncoils
+        C = zeros(ncoils);
+        for framen = 1:nframes
+            b = aslrec.getframe(kdata,fidx(framen),kmsk);
+            C = C + double(b'*b);
+        end
+        [V,d] = eig((C+C')/2, 'vector');
+        [~,i] = sort(d, 'descend');
+        ccmat = single(V(:,i(1:ncc)));
+        if size(args.smap,4) == ncoils % compress the map with the same matrix
+            args.smap = reshape(reshape(args.smap,[],ncoils)*double(ccmat), [N(:)',ncc]);
+        end
+    end
+    stats = aslrec.logstage(stats, 'cc', t0);
+    smap = args.smap;
+    
+end
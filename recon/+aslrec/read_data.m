@@ -1,5 +1,11 @@
-function [kdata,klocs,N,fov] = read_data(pfile)
+function [kdata,klocs,N,fov,vmsk,fidx] = read_data(pfile)
 % Function to read in the pfile and .txt file data and format it for recon
+%   (a .mat file saved by aslrec.synthdata can also be passed as pfile).
+%   kdata is kept in the native precision of the file (complex integers for
+%   pfiles), see aslrec.getframe for extracting frames for recon. Empty
+%   views and frames are not removed from kdata (that would copy it), they
+%   are returned as a view mask (vmsk) and the indicies of the acquired
+%   frames (fidx) instead.
 
     if nargin < 1 || isempty(pfile)
         pfile = './P*.7'; % default: use first Pfile on current path
@@ -12,31 +18,48 @@ function [kdata,klocs,N,fov] = read_data(pfile)
     end
     pfile = tmp(1).name;
     pdir = tmp(1).folder;
+    
+    % load pre-formatted data (i.e. synthetic data)
+    if endsWith(pfile,'.mat')
+        load([pdir,'/',pfile],'kdata','klocs','N','fov');
+        vmsk = true(1,size(kdata,2));
+        fidx = 1:size(kdata,3);
+        return
+    end
+    
     [raw,hdr] = aslrec.ge.read_pfile([pdir,'/',pfile]);
-    raw(:,all(raw == 0, [1,3:5]),:,:,:) = []; % remove empty views
-    raw(:,:,all(raw == 0, [1:2,4:5]),:,:) = []; % remove empty frames
     nviews = size(raw,2);
     nframes = size(raw,3);
     ncoils = size(raw,5);
     kdata = reshape(raw,[],nviews,nframes,ncoils);
+    clear raw
+
+    % find the acquired views and frames, one coil at a time
+    acq = false(nviews,nframes);
+    for coiln = 1:ncoils
+        acq = acq | reshape(any(kdata(:,:,:,coiln) ~= 0, 1), nviews, nframes);
+    end
+    vmsk = any(acq,2)'; % mask of acquired views
+    fidx = find(any(acq,1)); % indicies of acquired frames
     
     % find and read the ktraj file
     tmp = dir([pdir,'/ktraj*.txt']);
     ktrajfile = tmp(1).name;
-    klocs0 = load(ktrajfile);
+    klocs0 = load([pdir,'/',ktrajfile]);
     
     % find and read the kviews file
     tmp = dir([pdir,'/kviews*.txt']);
     kviewsfile = tmp(1).name;
-    kviews = load(kviewsfile);
+    kviews = load([pdir,'/',kviewsfile]);
     
-    % transform kspace locations using rotation matrices
-    klocs = zeros(size(klocs0,1),3,nviews); % klocs = [N x 3 x nviews]
-    for viewn = 1:nviews
-        R = reshape(kviews(viewn,end-8:end)',3,3)';
-        klocs(:,:,viewn) = klocs0*R';
+    % transform kspace locations using rotation matrices (per frame if the
+    %   views are rotated across frames), indexed like the pfile views
+    klocs = aslrec.transformviews(klocs0, kviews); % klocs = [N x nviews x 3 x nkframes]
+    if find(vmsk, 1, 'last') > size(klocs,2)
+        error('pfile has more views (%d) than the kviews table (%d per frame)', ...
+            find(vmsk, 1, 'last'), size(klocs,2));
     end
-    klocs = permute(klocs,[1,3,2]); % klocs = [N x nviews x 3]
+    klocs(:,end+1:nviews,:,:) = 0; % pad the unused views of the pfile
     
     % save N and fov
     N = hdr.image.dim_X * ones(1,3);
@@ -0,0 +1,53 @@
+function info = read_scaninfo(searchstr)
+% Function to read the scaninfo.txt file written by write_scan_info() in
+%   umvsasl.e into a structure
+%
+% by David Frey
+%
+% Each 'name: value [unit]' line becomes a field with the name converted
+%   to lowercase with underscores (i.e. 'Prep 1 post-labeling delay' ->
+%   prep_1_post_labeling_delay, '3D slab thickness' -> x3d_slab_thickness).
+%   Values are converted to numbers when they start with one (i.e.
+%   '1 (LCLC)' -> 1), otherwise they are kept as strings. Units are not
+%   converted.
+%
+
+    if nargin < 1 || isempty(searchstr)
+        searchstr = './scaninfo*.txt'; % default: use first scaninfo file on current path
+    end
+
+    % find the scaninfo file
+    tmp = dir(searchstr);
+    if isempty(tmp)
+        error('no scaninfo files found from search string: %s', searchstr);
+    end
+    fid = fopen([tmp(1).folder,'/',tmp(1).name],'r');
+
+    % loop through lines
+    info = struct();
+    while true
+        ln = fgetl(fid);
+        if ~ischar(ln)
+            break
+        end
+
+        % skip section headers (no value after the colon)
+        tok = regexp(ln, '^\s*(.+?):\s+(\S.*?)\s*$', 'tokens', 'once');
+        if isempty(tok)
+            continue
+        end
+
+        % make the field name
+        name = lower(regexprep(strtrim(tok{1}), '[^a-zA-Z0-9]+', '_'));
+        name = matlab.lang.makeValidName(regexprep(name, '^_+|_+$', ''));
+
+        % convert the value
+        val = sscanf(tok{2}, '%f', 1);
+        if isempty(val)
+            val = tok{2};
+        end
+        info.(name) = val;
+    end
+    fclose(fid);
+
+end
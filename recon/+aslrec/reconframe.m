@@ -0,0 +1,84 @@
+function x = reconframe(A, w, b, N, niter, msg_pfx, reduce, x0)
+% Function to reconstruct a single frame with CG, initialized with the
+%   density compensated adjoint solution (see aslrec.initframe)
+%
+% by David Frey
+%
+% Arguments:
+%   - A: system operator (NUFFT, or Asense for multiple coils)
+%   - w: density compensation weights
+%   - b: kspace data for the frame [nsamp x ncoils] (samples inside the
+%       nufft bandwidth only, i.e. from aslrec.getframe)
+%   - N: image size
+%   - niter: number of iterations for CG reconstruction
+%   - msg_pfx: prefix for output messages
+%   - reduce: function to sum partial results over a coil partition of the
+%       operator (i.e. across workers in recondist), where A and b only hold
+%       a subset of the coils; leave empty for a single operator
+%   - x0: initial solution from aslrec.initframe (optional, computed here
+%       if empty)
+%
+% Output:
+%   - x: reconstructed image, single precision (the solve itself runs in
+%       double precision, as required by the MIRT nufft)
+%
+
+    % set default message prefix
+    if nargin < 6
+        msg_pfx = '';
+    end
+    if nargin < 7
+        reduce = [];
+    end
+    if nargin < 8 || isempty(x0)
+        x0 = aslrec.initframe(A, w, b, N, msg_pfx, reduce);
+    end
+    if isempty(reduce)
+        reduce = @(x) x;
+    end
+
+    % solve in double precision (as required by the MIRT nufft)
+    b = double(b);
+    x0 = double(x0);
+
+    % solve with CG
+    x = single(cg_solve(x0, A, b, niter, msg_pfx, reduce));
+
+end
+
+function x_star = cg_solve(x0, A, b, niter, msg_pfx, reduce)
+
+    % set default message prefix
+    if nargin < 5
+        msg_pfx = '';
+    end
+    if nargin < 6
+        reduce = @(x) x;
+    end
+
+    % loop through iterations of conjugate gradient descent
+    x_star = x0;
+    r = reduce(reshape(A'*(b - A*x_star), size(x_star)));
+    p = r;
+    rsold = r(:)' * r(:);
+    for n = 1:niter
+        fprintf('%sCG iteration %d/%d, res: %.3g\n', msg_pfx, n, niter, rsold);
+        
+        % calculate the gradient descent step
+        AtAp = reduce(reshape(A'*(A*p), size(x_star)));
+        alpha = rsold / (p(:)' * AtAp(:));
+        x_star = x_star + alpha * p;
+
+        % calculate new residual
+        r = r - alpha * AtAp;
+        rsnew = r(:)' * r(:);
+        p = r + (rsnew / rsold) * p;
+        rsold = rsnew;
+
+        if exist('exitcg','var')
+            break % set a variable called "exitcg" to exit at current iteration when debugging
+        end
+
+    end
+    
+end
@@ -0,0 +1,201 @@
+function [kdata,klocs,N,fov,smap,x] = synthdata(varargin)
+% Function to synthesize multi-coil, multi-frame umvsasl kspace data of a
+%   3D numerical phantom for testing and benchmarking the recon
+%
+% by David Frey
+%
+% Required paths:
+%   - MIRT (git@github.com:JeffFessler/mirt.git)
+%
+% The phantom is a 3D Shepp-Logan head with the brain compartment
+%   modulated by the label/control scheme. Coil sensitivities are smooth
+%   maps from coils distributed around the head. The kspace trajectory is
+%   an archimedean spiral (approximating genspiral() output) transformed
+%   by the view table from aslrec.genviews(), unless ktraj/kviews files are
+%   given. Outputs match the format of aslrec.read_data().
+%
+% Arguments:
+%   - N: image matrix size (isotropic)
+%   - fov: field of view (cm)
+%   - ncoils: number of receive coils
+%   - nframes: number of frames
+%   - narms: number of spiral arms
+%   - nshots: number of shots
+%   - etl: echo train length, leave empty for full kz coverage (SOS)
+%   - spi_mode: SOS (0), TGA (1), or 3DTGA (2)
+%   - frame_rot: option to rotate the views of each frame by the golden
+%       angle (see aslrec.genviews)
+%   - nnav: number of navigator points at the start of each readout
+%   - nspiral: number of samples in the spiral
+%   - ktraj: ktraj file to use instead of the synthetic spiral
+%   - kviews: kviews file to use instead of aslrec.genviews()
+%   - mod: labeling modulation scheme (same as prep1_mod: 1 = LCLC,
+%       2 = CLCL, 3 = LLLL, 4 = CCCC)
+%   - dm: fractional signal change of brain tissue in label frames
+%   - snr: kspace signal to noise ratio (Inf for no noise)
+%   - savefile: .mat file to save the data to (readable by
+%       aslrec.read_data() and recon3dflex), leave empty to skip saving
+%
+
+    % set defaults
+    defaults.N = 64;
+    defaults.fov = 20;
+    defaults.ncoils = 32;
+    defaults.nframes = 4;
+    defaults.narms = 4;
+    defaults.nshots = 2;
+    defaults.etl = [];
+    defaults.spi_mode = 0;
+    defaults.frame_rot = 0;
+    defaults.nnav = 250;
+    defaults.nspiral = 3000;
+    defaults.ktraj = [];
+    defaults.kviews = [];
+    defaults.mod = 1;
+    defaults.dm = 0.01;
+    defaults.snr = 50;
+    defaults.savefile = [];
+
+    % parse input parameters
+    args = vararg_pair(defaults, varargin);
+    N = args.N * ones(1,3);
+    fov = args.fov * ones(1,3);
+    if isempty(args.etl)
+        args.etl = ceil(args.N / args.nshots);
+    end
+
+    % get the kspace trajectory
+    if isempty(args.ktraj)
+        kxymax = args.N / args.fov / 2;
+        kzmax = (args.spi_mode == 0) * args.etl * args.nshots / args.fov / 2;
+        t = linspace(0, 1, args.nspiral)';
+        kr = kxymax * t .* exp(1i * 2*pi * args.N / (2*args.narms) * t);
+        ktraj = [zeros(args.nnav,2); real(kr), imag(kr)];
+        ktraj(:,3) = kzmax;
+    else
+        ktraj = load(args.ktraj);
+    end
+    if isempty(args.kviews)
+        kviews = aslrec.genviews('narms', args.narms, 'nshots', args.nshots, ...
+            'etl', args.etl, 'spi_mode', args.spi_mode, ...
+            'nframes', args.nframes, 'frame_rot', args.frame_rot);
+    else
+        kviews = load(args.kviews);
+    end
+
+    % transform kspace locations using rotation matrices
+    klocs = aslrec.transformviews(ktraj, kviews); % klocs = [N x nviews x 3 x nkframes]
+    nviews = size(klocs,2);
+    nkframes = size(klocs,4);
+
+    % make the phantom and coil sensitivities
+    [x, xbrain] = shepplogan3d(N);
+    smap = coilsens(N, args.ncoils);
+
+    % set up the nuffts for each set of views (same arguments as recon3dflex)
+    nufft_args = {N, 6*ones(1,3), 2*N, N/2, 'table', 2^10, 'minmax:kb'};
+    omega_msk = false(size(klocs,1)*nviews, nkframes);
+    A = cell(1,nkframes);
+    for kframen = 1:nkframes
+        omega = 2*pi*fov(:)'./N(:)'.*reshape(klocs(:,:,:,kframen),[],3);
+        omega_msk(:,kframen) = vecnorm(omega,2,2) < pi;
+        A{kframen} = Gnufft(true(N),[omega(omega_msk(:,kframen),:),nufft_args]);
+    end
+
+    % determine which frames are labeled
+    switch args.mod
+        case 1 % label, control...
+            islbl = mod(0:args.nframes-1, 2) == 0;
+        case 2 % control, label...
+            islbl = mod(0:args.nframes-1, 2) == 1;
+        case 3 % label
+            islbl = true(1,args.nframes);
+        case 4 % control
+            islbl = false(1,args.nframes);
+    end
+
+    % simulate the data coil by coil
+    fprintf('synthesizing %d coils x %d frames x %d views of kspace data...\n', ...
+        args.ncoils, args.nframes, nviews);
+    kdata = zeros(size(ktraj,1), nviews, args.nframes, args.ncoils, 'single');
+    sigma = 0;
+    for coiln = 1:args.ncoils
+        for kframen = 1:nkframes
+            m = omega_msk(:,kframen);
+            kctl = zeros(size(omega_msk,1),1);
+            kbrain = zeros(size(omega_msk,1),1);
+            kctl(m) = A{kframen} * reshape(smap(:,:,:,coiln).*x, [], 1);
+            kbrain(m) = A{kframen} * reshape(smap(:,:,:,coiln).*xbrain, [], 1);
+            if coiln == 1 && kframen == 1 && ~isinf(args.snr) % set noise level from the 1st coil
+                sigma = sqrt(mean(abs(kctl(m)).^2)) / args.snr;
+            end
+            for framen = kframen:nkframes:args.nframes % frames acquired with these views
+                b = kctl - islbl(framen) * args.dm * kbrain;
+                b = b + sigma/sqrt(2) * (randn(size(b)) + 1i*randn(size(b)));
+                kdata(:,:,framen,coiln) = reshape(b, [], nviews);
+            end
+        end
+    end
+
+    % save the data
+    if ~isempty(args.savefile)
+        fprintf('saving data to %s...\n', args.savefile);
+        save(args.savefile, 'kdata', 'klocs', 'N', 'fov', 'smap', ...
+            'ktraj', 'kviews', '-v7.3');
+    end
+
+end
+
+function [x, xbrain] = shepplogan3d(N)
+% 3D (modified) Shepp-Logan head phantom, also returns brain compartment
+
+    % ellipsoid parameters: [A, a, b, c, x0, y0, z0, phi (deg)]
+    E = [   1   .69    .92   .81   0     0      0    0
+          -.8  .6624  .874  .78   0    -.0184  0    0
+          -.2  .11    .31   .22   .22   0      0   -18
+          -.2  .16    .41   .28  -.22   0      0    18
+           .1  .21    .25   .41   0     .35   -.15  0
+           .1  .046   .046  .05   0     .1     .25  0
+           .1  .046   .046  .05   0    -.1     .25  0
+           .1  .046   .023  .05  -.08  -.605   0    0
+           .1  .023   .023  .02   0    -.606   0    0
+           .1  .023   .046  .02   .06  -.605   0    0 ];
+
+    [X,Y,Z] = ndgrid(linspace(-1,1,N(1)), linspace(-1,1,N(2)), linspace(-1,1,N(3)));
+    x = zeros(N);
+    inside = false([N,size(E,1)]);
+    for n = 1:size(E,1)
+        c = cosd(E(n,8));
+        s = sind(E(n,8));
+        Xr = c*(X - E(n,5)) + s*(Y - E(n,6));
+        Yr = -s*(X - E(n,5)) + c*(Y - E(n,6));
+        Zr = Z - E(n,7);
+        inside(:,:,:,n) = (Xr/E(n,2)).^2 + (Yr/E(n,3)).^2 + (Zr/E(n,4)).^2 <= 1;
+        x = x + E(n,1) * inside(:,:,:,n);
+    end
+
+    % brain = inside the skull, outside the ventricles
+    xbrain = x .* (inside(:,:,:,2) & ~inside(:,:,:,3) & ~inside(:,:,:,4));
+
+end
+
+function smap = coilsens(N, ncoils)
+% smooth complex coil sensitivities from coils on a sphere around the head
+
+    [X,Y,Z] = ndgrid(linspace(-1,1,N(1)), linspace(-1,1,N(2)), linspace(-1,1,N(3)));
+
+    % distribute coils on a fibonacci lattice
+    n = (0:ncoils-1)' + 0.5;
+    polar = acos(1 - 2*n/ncoils);
+    azim = pi * (1 + sqrt(5)) * n;
+    rc = 1.5 * [sin(polar).*cos(azim), sin(polar).*sin(azim), cos(polar)];
+
+    % calculate the sensitivities and normalize to unit root sum of squares
+    smap = zeros([N,ncoils]);
+    for coiln = 1:ncoils
+        d = sqrt((X - rc(coiln,1)).^2 + (Y - rc(coiln,2)).^2 + (Z - rc(coiln,3)).^2);
+        smap(:,:,:,coiln) = exp(-d) .* exp(1i*pi/2*(rc(coiln,1)*X + rc(coiln,2)*Y + rc(coiln,3)*Z));
+    end
+    smap = smap ./ sqrt(sum(abs(smap).^2,4));
+
+end
@@ -0,0 +1,38 @@
+function klocs = transformviews(ktraj, kviews)
+% Function to transform the kspace trajectory by the view transformation
+%   matrices in the kviews table (kviews.txt or aslrec.genviews output)
+%
+% by David Frey
+%
+% The number of views per frame is the number of unique (arm, shot, echo)
+%   rows in the table (narms*nshots*etl), independent of which views were
+%   actually acquired. If the views are rotated across frames (frame_rot =
+%   1 in umvsasl.e), the table holds that many rows for each frame (in
+%   frame order) and a separate set of kspace locations is returned for
+%   each frame, otherwise the first set of rows is used for all frames.
+%
+% Arguments:
+%   - ktraj: kspace trajectory [nsamp x 3]
+%   - kviews: view table, rows [armn, shotn, echon, rz, dz, T(:)']
+%
+% Output:
+%   - klocs: kspace locations [nsamp x nviews x 3 x nkframes], where
+%       nviews is the number of views per frame and nkframes is 1 (same
+%       views for all frames) or the number of frames
+%
+
+    % get the number of views per frame and sets of views
+    nviews = size(unique(kviews(:,1:3),'rows'),1);
+    nkframes = floor(size(kviews,1) / nviews);
+
+    % transform kspace locations using rotation matrices
+    klocs = zeros(size(ktraj,1),3,nviews,nkframes); % klocs = [N x 3 x nviews x nkframes]
+    for framen = 1:nkframes
+        for viewn = 1:nviews
+            R = reshape(kviews((framen-1)*nviews + viewn,end-8:end)',3,3)';
+            klocs(:,:,viewn,framen) = ktraj*R';
+        end
+    end
+    klocs = permute(klocs,[1,3,2,4]); % klocs = [N x nviews x 3 x nkframes]
+
+end
@@ -0,0 +1,153 @@
+function [cbf, dm] = aslquant(varargin)
+% Function for label/control subtraction and CBF quantification of umvsasl
+%   image series
+%
+% by David Frey
+%
+% Usage:
+% Specify the reconstructed images using the 'x' argument (an array or a
+%   .mat file containing x, i.e. saved by benchrecon or from recon3dflex
+%   output), and run this function from the data directory or specify the
+%   scaninfo file. The labeling modulation, PLDs and background suppression
+%   timings are read from scaninfo. Frames are read one label/control pair
+%   at a time (.mat files must be saved with -v7.3 for partial loading), so
+%   memory does not grow with the number of frames.
+%
+% CBF (ml/100g/min) is calculated from the single compartment model:
+%   cbf = 6000 * lambda * dm * exp(pld/T1b) / (2 * alpha * M0 * tau)
+%   where alpha is the labeling efficiency as defined in simpulsegrid,
+%   ((Mz_ctl - Mz_lbl)/2), reduced by alpha_bgs for each background
+%   suppression pulse, and tau is the bolus duration.
+%
+% Arguments:
+%   - x: image series [image size x nframes] or name of .mat file
+%   - scaninfo: scaninfo file search string
+%   - m0: M0 image (array, or .mat file containing m0), leave empty to only
+%       compute the difference images
+%   - mag: option to subtract magnitude images (0 subtracts complex images)
+%   - T1b: longitudinal relaxation time of arterial blood (s)
+%   - lambda: blood/tissue partition coefficient (ml/g)
+%   - alpha: labeling efficiency
+%   - alpha_bgs: efficiency of each background suppression pulse
+%   - tau: bolus duration (s), leave empty to use the PLD (velocity
+%       selective labeling)
+%   - savefile: .mat file to write the difference (dm) and cbf series to,
+%       one pair at a time, leave empty to skip
+%
+% Outputs:
+%   - cbf: mean CBF map (ml/100g/min), empty if no M0 is given
+%   - dm: mean control - label difference image
+%
+
+    % set defaults
+    defaults.x = [];
+    defaults.scaninfo = [];
+    defaults.m0 = [];
+    defaults.mag = 1;
+    defaults.T1b = 1.65;
+    defaults.lambda = 0.9;
+    defaults.alpha = 0.6;
+    defaults.alpha_bgs = 0.95;
+    defaults.tau = [];
+    defaults.savefile = [];
+
+    % parse input parameters
+    args = vararg_pair(defaults,varargin);
+
+    % set up the frame reader
+    if ischar(args.x)
+        xfile = matfile(args.x);
+        sz = size(xfile, 'x');
+        readframe = @(n) xfile.x(:,:,:,n);
+    else
+        sz = size(args.x);
+        readframe = @(n) args.x(:,:,:,n);
+    end
+    sz(end+1:4) = 1;
+    nframes = sz(4);
+
+    % read the M0 image
+    if ischar(args.m0)
+        args.m0 = load(args.m0, 'm0');
+        args.m0 = args.m0.m0;
+    end
+    args.m0 = abs(args.m0);
+
+    % get the prep pulse parameters from the scan info
+    info = aslrec.read_scaninfo(args.scaninfo);
+    mods = [];
+    plds = [];
+    nbgs = [];
+    for n = 1:2
+        pfx = sprintf('prep_%d_', n);
+        if ~isfield(info, [pfx,'pulse_id'])
+            continue % pulse is off
+        end
+        mods(end+1) = info.([pfx,'pulse_modulation']); %#ok<AGROW>
+        plds(end+1) = info.([pfx,'post_labeling_delay']) * 1e-3; %#ok<AGROW>
+        nbgs(end+1) = (info.([pfx,'bgs_1_delay']) > 0) + ...
+            (info.([pfx,'bgs_2_delay']) > 0) + (info.([pfx,'bgs_3_delay']) > 0); %#ok<AGROW>
+    end
+
+    % find the label/control modulated prep (the 1st alternating one)
+    lcn = find(ismember(mods, [1,2]), 1);
+    if isempty(lcn)
+        error('no prep pulse alternates label/control (modulation must be 1 or 2)');
+    end
+    islbl = mod((0:nframes-1) + (mods(lcn) == 2), 2) == 0; % 1 = LCLC, 2 = CLCL
+
+    % determine timing and efficiency from the label/control pulse onward
+    pld = sum(plds(lcn:end));
+    alpha = args.alpha * args.alpha_bgs^sum(nbgs(lcn:end));
+    if isempty(args.tau)
+        args.tau = pld;
+    end
+    fprintf('aslquant: %d pairs, PLD = %.3f s, alpha = %.3f, tau = %.3f s\n', ...
+        floor(nframes/2), pld, alpha, args.tau);
+
+    % set up the output file
+    if ~isempty(args.savefile)
+        out = matfile(args.savefile, 'Writable', true);
+    end
+
+    % loop through label/control pairs
+    npairs = floor(nframes/2);
+    dm = zeros(sz(1:3));
+    cbf = [];
+    for i = 1:npairs
+        fl = 2*(i-1) + find(islbl(2*i-1:2*i)); % label frame
+        fc = 2*(i-1) + find(~islbl(2*i-1:2*i)); % control frame
+
+        % subtract the pair
+        xl = readframe(fl);
+        xc = readframe(fc);
+        if args.mag
+            dm_i = abs(xc) - abs(xl);
+        else
+            dm_i = xc - xl;
+        end
+        dm = dm + dm_i / npairs;
+
+        % save the pair
+        if ~isempty(args.savefile)
+            out.dm(:,:,:,i) = dm_i;
+            if ~isempty(args.m0)
+                out.cbf(:,:,:,i) = quant(dm_i, args, pld, alpha);
+            end
+        end
+    end
+
+    % quantify the mean difference image
+    if ~isempty(args.m0)
+        cbf = quant(dm, args, pld, alpha);
+    else
+        warning('no M0 image given, returning difference images only');
+    end
+
+end
+
+function cbf = quant(dm, args, pld, alpha)
+    cbf = 6000 * args.lambda * dm * exp(pld/args.T1b) ./ ...
+        (2 * alpha * args.m0 * args.tau);
+    cbf(~isfinite(cbf)) = 0;
+end
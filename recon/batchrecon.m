@@ -0,0 +1,254 @@
+function jobs = batchrecon(varargin)
+% Function for batch reconstruction of all umvsasl exams in a data root
+%
+% by David Frey
+%
+% Usage:
+% All asldata_e*_s* directories under datadir are scanned and grouped by a
+%   hash of what the system operator depends on: the ktraj and kviews files
+%   and the image size and fov from the pfile header. The NUFFT operator and
+%   density compensation (aslrec.buildop) are built once per group and
+%   shared with the workers of a parallel pool (parallel.pool.Constant).
+%   Exams whose sample mask differs from the group operator (i.e. aborted
+%   scans with missing views) get their own operator. Each exam is read on
+%   the client and its frames are queued as separate tasks, so idle workers
+%   pick up frames from the next exam instead of waiting for the slowest
+%   frame of the current one. At most maxinflight exams are held in memory
+%   at once. Images are saved to outname in each exam directory, and
+%   throughput and per-job timings are reported. An exam that fails, or
+%   that has its views rotated across frames (frame_rot, which needs
+%   reconjoint or recon3dflex), is recorded in its job (error) and the
+%   batch moves on to the next exam.
+%
+% Required paths:
+%   - MIRT (git@github.com:JeffFessler/mirt.git), on the workers too
+%   - Parallel Computing Toolbox
+%
+% Arguments:
+%   - datadir: data root directory to scan for exams
+%   - pattern: exam directory search pattern
+%   - nworkers: number of pool workers (default is number of cores)
+%   - niter: number of iterations for CG reconstruction
+%   - smap: sensitivity maps, [] to compress to 1 coil or 'calib' to
+%       estimate maps for each exam (see recon3dflex)
+%   - ccfac: coil compression factor
+%   - maxinflight: maximum number of exams held in memory at once
+%   - outname: name of the output .mat file saved in each exam directory
+%   - overwrite: option to recon exams that already have outname
+%
+% Output:
+%   - jobs: structure array of per-exam timings, protocol group and error
+%       message (empty if the exam was reconstructed)
+%
+
+    % check that mirt is set up
+    aslrec.check4mirt();
+
+    % set defaults
+    defaults.datadir = '.';
+    defaults.pattern = 'asldata_e*_s*';
+    defaults.nworkers = feature('numcores');
+    defaults.niter = 0;
+    defaults.smap = 'calib';
+    defaults.ccfac = 1;
+    defaults.maxinflight = 2;
+    defaults.outname = 'recon.mat';
+    defaults.overwrite = 0;
+
+    % parse input parameters
+    args = vararg_pair(defaults,varargin);
+
+    % scan for exams and hash their protocols
+    d = dir(fullfile(args.datadir, args.pattern));
+    d = d([d.isdir]);
+    jobs = struct('exam', {}, 'dir', {}, 'hash', {}, 'group', {}, 'nframes', {}, ...
+        'tread', {}, 'tstart', {}, 'tend', {}, 'error', {});
+    for n = 1:length(d)
+        examdir = fullfile(d(n).folder, d(n).name);
+        if ~args.overwrite && isfile(fullfile(examdir, args.outname))
+            continue
+        end
+        ktrajfiles = dir(fullfile(examdir,'ktraj*.txt'));
+        kviewsfiles = dir(fullfile(examdir,'kviews*.txt'));
+        pfiles = dir(fullfile(examdir,'P*.7'));
+        if isempty(ktrajfiles) || isempty(kviewsfiles) || isempty(pfiles)
+            warning('skipping %s: missing pfile, ktraj or kviews file', d(n).name);
+            continue
+        end
+        jobs(end+1).exam = d(n).name; %#ok<AGROW>
+        jobs(end).dir = examdir;
+        jobs(end).group = 0;
+        files = fullfile({ktrajfiles(1).folder, kviewsfiles(1).folder}, ...
+            {ktrajfiles(1).name, kviewsfiles(1).name});
+        try
+
+            % skip exams with views rotated across frames (more view table
+            %   rows than unique views), they need a per-frame operator
+            kviews = load(files{2});
+            if size(kviews,1) > size(unique(kviews(:,1:3),'rows'),1)
+                jobs(end).error = 'views are rotated across frames (frame_rot), use reconjoint or recon3dflex';
+                warning('skipping %s: %s', d(n).name, jobs(end).error);
+                continue
+            end
+
+            % hash the trajectory, image size and fov
+            [~,hdr] = aslrec.ge.read_pfile(fullfile(pfiles(1).folder, pfiles(1).name), 1);
+            jobs(end).hash = aslrec.filehash(files, [hdr.image.dim_X, hdr.image.dfov]);
+
+        catch err
+            jobs(end).error = err.message;
+            warning('skipping %s: %s', d(n).name, err.message);
+        end
+    end
+    queued = find(cellfun(@isempty, {jobs.error})); % exams to recon
+    [hashes,~,grp] = unique({jobs(queued).hash});
+    for i = 1:length(queued)
+        jobs(queued(i)).group = grp(i);
+    end
+    fprintf('batchrecon: found %d exams in %d protocol groups (%d skipped)\n', ...
+        length(queued), length(hashes), length(jobs) - length(queued));
+    if isempty(queued)
+        return
+    end
+
+    % start the pool
+    pool = gcp('nocreate');
+    if isempty(pool) || pool.NumWorkers ~= args.nworkers
+        delete(pool);
+        pool = parpool(args.nworkers);
+    end
+
+    % loop through protocol groups
+    tbatch = tic;
+    inflight = struct('n', {}, 'f', {}, 'N', {});
+    for g = 1:length(hashes)
+        opC = [];
+        for n = queued(grp(:)' == g)
+            try
+
+                % read and prepare the data
+                jobs(n).tstart = toc(tbatch);
+                [kdata,klocs,N,fov,smap,~,kmsk,ccmat,fidx] = aslrec.prepdata( ...
+                    'pfile', fullfile(jobs(n).dir,'P*.7'), 'smap', args.smap, 'ccfac', args.ccfac);
+                if size(klocs,4) > 1
+                    jobs(n).error = 'views are rotated across frames (frame_rot), use reconjoint or recon3dflex';
+                    warning('skipping %s: %s', jobs(n).exam, jobs(n).error);
+                    clear kdata
+                    continue
+                end
+                nframes = length(fidx);
+                jobs(n).nframes = nframes;
+                jobs(n).tread = toc(tbatch) - jobs(n).tstart;
+
+                % build the shared operator from the 1st exam in the group,
+                %   or a separate one if the exam's samples don't match it
+                if isempty(opC)
+                    fprintf('batchrecon: building operator for protocol group %d/%d...\n', g, length(hashes));
+                    op = aslrec.buildop(klocs,N,fov,[],kmsk);
+                    msk = op.msk;
+                    opC = parallel.pool.Constant(op);
+                    opkmsk = kmsk;
+                    opsz = size(klocs);
+                    clear op
+                    examopC = opC;
+                    exammsk = msk;
+                elseif ~isequal(size(klocs), opsz) || ~isequal(kmsk, opkmsk)
+                    warning('%s: samples differ from protocol group %d, building a separate operator', ...
+                        jobs(n).exam, g);
+                    op = aslrec.buildop(klocs,N,fov,[],kmsk);
+                    exammsk = op.msk;
+                    examopC = parallel.pool.Constant(op);
+                    clear op
+                else
+                    examopC = opC;
+                    exammsk = msk;
+                end
+                smapC = parallel.pool.Constant(smap);
+
+                % queue the frames
+                f = parallel.FevalFuture.empty;
+                for framen = 1:nframes
+                    b = aslrec.getframe(kdata,fidx(framen),exammsk,ccmat);
+                    f(framen) = parfeval(pool, @solveframe, 1, examopC, smapC, b, args.niter, ...
+                        sprintf('%s frame %d/%d: ', jobs(n).exam, framen, nframes));
+                end
+                clear kdata b
+                inflight(end+1) = struct('n', n, 'f', f, 'N', N); %#ok<AGROW>
+
+            catch err
+                jobs(n) = failjob(jobs(n), err, tbatch);
+                clear kdata b
+            end
+
+            % finish the oldest exams to bound memory
+            while length(inflight) >= args.maxinflight
+                jobs(inflight(1).n) = finishjob(jobs(inflight(1).n), inflight(1), args, tbatch);
+                inflight(1) = [];
+            end
+
+        end
+    end
+
+    % finish the remaining exams
+    while ~isempty(inflight)
+        jobs(inflight(1).n) = finishjob(jobs(inflight(1).n), inflight(1), args, tbatch);
+        inflight(1) = [];
+    end
+    ttotal = toc(tbatch);
+
+    % report the timings
+    fprintf('batchrecon: per-job timings\n');
+    fprintf('\t%-40s%8s%8s%12s%12s\n', 'exam', 'group', 'frames', 'read (s)', 'total (s)');
+    ok = cellfun(@isempty, {jobs.error});
+    for n = find(ok)
+        fprintf('\t%-40s%8d%8d%12.1f%12.1f\n', jobs(n).exam, jobs(n).group, ...
+            jobs(n).nframes, jobs(n).tread, jobs(n).tend - jobs(n).tstart);
+    end
+    for n = find(~ok)
+        fprintf('\t%-40s%8d  skipped/failed: %s\n', jobs(n).exam, jobs(n).group, jobs(n).error);
+    end
+    fprintf('batchrecon: %d exams (%d frames) in %.1f s: %.2f frames/s, %.1f exams/hour (%d skipped or failed)\n', ...
+        sum(ok), sum([jobs(ok).nframes]), ttotal, sum([jobs(ok).nframes])/ttotal, ...
+        3600*sum(ok)/ttotal, sum(~ok));
+
+end
+
+function x = solveframe(opC, smapC, b, niter, msg_pfx)
+% recon a single frame on a worker with the shared operator
+
+    op = opC.Value;
+    A = op.A;
+    if size(b,2) > 1 % sensitivity encoding
+        A = Asense(A, smapC.Value);
+    end
+    x = aslrec.reconframe(A, op.w, b, op.N, niter, msg_pfx);
+
+end
+
+function job = finishjob(job, exam, args, tbatch)
+% wait for all frames of an exam and save the images
+
+    try
+        x = zeros([exam.N(:)', length(exam.f)], 'single');
+        for framen = 1:length(exam.f)
+            x(:,:,:,framen) = fetchOutputs(exam.f(framen));
+        end
+        save(fullfile(job.dir, args.outname), 'x', '-v7.3');
+    catch err
+        cancel(exam.f);
+        job = failjob(job, err, tbatch);
+        return
+    end
+    job.tend = toc(tbatch);
+    fprintf('batchrecon: finished %s (%.1f s)\n', job.exam, job.tend - job.tstart);
+
+end
+
+function job = failjob(job, err, tbatch)
+% record the error of a failed exam
+
+    job.error = err.message;
+    job.tend = toc(tbatch);
+    warning('batchrecon: %s failed: %s', job.exam, err.message);
+
+end
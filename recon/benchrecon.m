@@ -0,0 +1,116 @@
+function results = benchrecon(varargin)
+% Function for benchmarking recon3dflex on synthetic umvsasl data
+%
+% by David Frey
+%
+% Usage:
+% For each matrix size in N, synthetic kspace data is generated with
+%   aslrec.synthdata and saved to a temporary .mat file, then recon3dflex
+%   is run on it and the time and memory of each recon stage is reported.
+%   Each run is appended as a row to resultfile along with the current git
+%   commit so that results can be compared across commits. Since the peak
+%   memory is process-wide, run each benchmark in a fresh MATLAB session
+%   for comparable peak memory numbers.
+%
+% Required paths:
+%   - MIRT (git@github.com:JeffFessler/mirt.git)
+%
+% Arguments:
+%   - N: image matrix sizes to benchmark
+%   - ncoils: number of receive coils
+%   - nframes: number of frames
+%   - narms: number of spiral arms
+%   - nshots: number of shots
+%   - spi_mode: SOS (0), TGA (1), or 3DTGA (2)
+%   - niter: number of CG iterations
+%   - sense: option to recon with the synthetic SENSE map (0 compresses
+%       data to a single coil)
+%   - resultfile: csv file to append results to (leave empty to skip)
+%   - tmpdir: directory for the temporary data and image files
+%
+
+    % check that mirt is set up
+    aslrec.check4mirt();
+
+    % set defaults
+    defaults.N = [64, 128];
+    defaults.ncoils = 32;
+    defaults.nframes = 4;
+    defaults.narms = 4;
+    defaults.nshots = 2;
+    defaults.spi_mode = 0;
+    defaults.niter = 10;
+    defaults.sense = 1;
+    defaults.resultfile = 'bench_results.csv';
+    defaults.tmpdir = tempdir;
+
+    % parse input parameters
+    args = vararg_pair(defaults,varargin);
+
+    % get the current commit for comparison across commits
+    [status, commit] = system(sprintf('git -C "%s" rev-parse --short HEAD', ...
+        fileparts(mfilename('fullpath'))));
+    if status ~= 0
+        commit = 'unknown';
+    end
+    commit = strtrim(commit);
+
+    stages = {'read', 'cc', 'nufft', 'dcf', 'init', 'cg', 'write'};
+    results = struct([]);
+    for n = 1:length(args.N)
+
+        % generate the synthetic data
+        datafile = fullfile(args.tmpdir, sprintf('benchdata_N%d.mat', args.N(n)));
+        [~,~,~,~,smap] = aslrec.synthdata('N', args.N(n), 'ncoils', args.ncoils, ...
+            'nframes', args.nframes, 'narms', args.narms, 'nshots', args.nshots, ...
+            'spi_mode', args.spi_mode, 'savefile', datafile);
+        if ~args.sense
+            smap = [];
+        end
+
+        % run the recon
+        [x, stats] = recon3dflex('pfile', datafile, 'smap', smap, 'niter', args.niter);
+
+        % write the images
+        t0 = tic;
+        save(fullfile(args.tmpdir, sprintf('benchimg_N%d.mat', args.N(n))), 'x', '-v7.3');
+        stats = aslrec.logstage(stats, 'write', t0);
+        clear x smap
+        delete(datafile);
+
+        % print the stage report
+        fprintf('benchrecon: N = %d, ncoils = %d, nframes = %d, niter = %d (commit %s)\n', ...
+            args.N(n), args.ncoils, args.nframes, args.niter, commit);
+        fprintf('\t%-10s%12s%12s%12s\n', 'stage', 'time (s)', 'rss (MB)', 'peak (MB)');
+        for i = 1:length(stages)
+            s = stats.(stages{i});
+            fprintf('\t%-10s%12.3f%12.1f%12.1f\n', stages{i}, s.time, s.rss, s.peakrss);
+        end
+
+        % append the results
+        results(n).commit = commit;
+        results(n).N = args.N(n);
+        results(n).stats = stats;
+        if ~isempty(args.resultfile)
+            newfile = ~isfile(args.resultfile);
+            fid = fopen(args.resultfile, 'a');
+            if newfile
+                fprintf(fid, 'date,commit,N,ncoils,nframes,narms,nshots,spi_mode,niter,sense');
+                hdrnames = repmat(stages, 3, 1);
+                fprintf(fid, ',%s_time,%s_rss,%s_peakrss', hdrnames{:});
+                fprintf(fid, '\n');
+            end
+            fprintf(fid, '%s,%s,%d,%d,%d,%d,%d,%d,%d,%d', ...
+                datestr(now,'yyyy-mm-dd HH:MM:SS'), commit, args.N(n), args.ncoils, ...
+                args.nframes, args.narms, args.nshots, args.spi_mode, args.niter, args.sense);
+            for i = 1:length(stages)
+                s = stats.(stages{i});
+                fprintf(fid, ',%.4f,%.1f,%.1f', s.time, s.rss, s.peakrss);
+            end
+            fprintf(fid, '\n');
+            fclose(fid);
+        end
+
+    end
+
+end
@@ -1,4 +1,4 @@
-function x = recon3dflex(varargin)
+function [x, stats] = recon3dflex(varargin)
 % Function for performing CG-SENSE NUFFT reconstruction for umvsasl data
 %
 % by David Frey
@@ -18,15 +18,26 @@ function x = recon3dflex(varargin)
 %   - pfile: pfile name search string, leave empty to use first P*.7 file
 %       in current working directory
 %   - smap: sensitivity map (must be [image size x ncoils]), leave empty
-%       to compress coils
+%       to compress coils, or pass 'calib' to estimate maps from the center
+%       of kspace using aslrec.calsmaps
 %   - niter: number of iterations for CG reconstruction
 %   - coilwise: option to rearrange data for coil-wise recon of 1st frame,
 %       this is useful for creating SENSE maps from fully-sampled data
+%       (smap = 'calib' is a much faster alternative)
 %   - resfac: image space resolution upsampling factor
 %   - ccfac: coil compression factor (i.e. ccfac = 4 will compressed data
 %       to 1/4 of the channels)
 %   - frames: frame indicies to reconstruct (default is all frames,
 %       reconned sequentially)
+%   - op: system operator from aslrec.buildop to reuse (i.e. from a previous
+%       exam with the same protocol), leave empty to build a new one
+%       (ignored if the views are rotated across frames, then an operator
+%       is built for each frame; see reconjoint for undersampled frames)
+%
+% Outputs:
+%   - x: reconstructed images [image size x nframes] (single precision)
+%   - stats: elapsed time (s) and resident memory (MB) at the end of each
+%       recon stage (read, smap, cc, nufft, dcf, init, cg), see aslrec.logstage
 %
 
     % check that mirt is set up
@@ -40,114 +51,79 @@ function x = recon3dflex(varargin)
     defaults.resfac = 1;
     defaults.ccfac = 1;
     defaults.frames = [];
+    defaults.op = [];
     
     % parse input parameters
     args = vararg_pair(defaults,varargin);
 
-    % get data from pfile
-    [kdata,klocs,N,fov] = aslrec.read_data(args.pfile);
-    if args.coilwise % rearrange for coil-wise reconstruction of frame 1 (for making SENSE maps)
-        kdata = permute(kdata(:,:,1,:),[1,2,4,3]);
-    end
-    N = ceil(N*args.resfac); % upsample N
-    
-    % cut off first 50 pts of acquisition (sometimes gets corrupted)
-    kdata(1:50,:,:,:) = [];
-    klocs(1:50,:,:) = [];
+    % read and prepare the data
+    [kdata,klocs,N,fov,args.smap,stats,kmsk,ccmat,fidx] = aslrec.prepdata('pfile', args.pfile, ...
+        'smap', args.smap, 'coilwise', args.coilwise, 'resfac', args.resfac, ...
+        'ccfac', args.ccfac);
     
     % get sizes
-    nframes = size(kdata,3); % number of frames
+    nframes = length(fidx); % number of frames
     ncoils = size(kdata,4); % number of coils
+    if ~isempty(ccmat)
+        ncoils = size(ccmat,2); % number of compressed coils
+    end
     if isempty(args.frames)
         args.frames = 1:nframes; % default - use all frames
     end
     
-    % do coil compression
-    if isempty(args.smap) && (ncoils > 1)
-        ncoils = 1;
-        warning('sense map is empty, compressing data to 1 coil...');
-        kdata = ir_mri_coil_compress(kdata,'ncoil',ncoils);
-    elseif (args.ccfac > 1) && (size(args.smap,4) == ncoils)
-        ncoils = ceil(ncoils/args.ccfac);
-        fprintf('compressing data & SENSE map to %d coils...\n', ncoils);
-        kdata = ir_mri_coil_compress(kdata,'ncoil',ncoils);
-        args.smap = ir_mri_coil_compress(args.smap,'ncoil',ncoils);
-    elseif size(args.smap,4) < ncoils
-        ncoils = size(args.smap,4);
-        warning('compressing data down to %d coils to match SENSE map...', ncoils);
-        kdata = ir_mri_coil_compress(kdata,'ncoil',ncoils);
-    end
-    
-    % set nufft arguments
-    nufft_args = {N, 6*ones(1,3), 2*N, N/2, 'table', 2^10, 'minmax:kb'};
-
     % initialize x
-    x = zeros([N(:)',length(args.frames)]);
+    x = zeros([N(:)',length(args.frames)],'single');
     
-    % calculate a new system operator
-    omega = 2*pi*fov(:)'./N(:)'.*reshape(klocs,[],3);
-    omega_msk = vecnorm(omega,2,2) < pi;
-    omega = omega(omega_msk,:);
-    A = Gnufft(true(N),[omega,nufft_args]); % NUFFT
-    w = aslrec.pipedcf(A,3); % calculate density compensation
-    if ncoils > 1 % sensitivity encoding
-        A = Asense(A,args.smap);
+    % calculate a new system operator (one per frame if the views are
+    %   rotated across frames)
+    nkframes = size(klocs,4); % number of sets of views
+    nt = length(args.frames);
+    ops = cell(1,nt);
+    A = cell(1,nt);
+    if nkframes > 1
+        t0 = tic;
+        for i = 1:nt
+            ops{i} = aslrec.buildop(klocs(:,:,:,args.frames(i)),N,fov,[],kmsk);
+        end
+        stats = aslrec.logstage(stats, 'op', t0);
+    else
+        if isempty(args.op)
+            [args.op, stats] = aslrec.buildop(klocs,N,fov,stats,kmsk);
+        end
+        ops(:) = {args.op};
+    end
+    clear klocs
+    for i = 1:nt
+        if i == 1 || nkframes > 1
+            Ai = ops{i}.A;
+            if ncoils > 1 % sensitivity encoding
+                Ai = Asense(Ai,args.smap);
+            end
+        end
+        A{i} = Ai;
     end
     
+    % initialize each frame with the density compensated adjoint solution
+    t0 = tic;
+    for i = 1:nt
+        b = aslrec.getframe(kdata,fidx(args.frames(i)),ops{i}.msk,ccmat);
+        x(:,:,:,i) = aslrec.initframe(A{i}, ops{i}.w, b, N, ...
+            sprintf('frame %d/%d: ', i, nt));
+    end
+    stats = aslrec.logstage(stats, 'init', t0);
+    
     % loop through frames and recon
-    for i = 1:length(args.frames)
-        framen = args.frames(i);
-
-        % get data for current frame
-        b = reshape(kdata(:,:,framen,:),[],ncoils);
-        b = b(omega_msk,:);
+    t0 = tic;
+    for i = 1:nt
         
-        % initialize with density compensated adjoint solution
-        fprintf("frame %d/%d: initializing solution x0 = A'*(w.*b)\n", i, length(args.frames))
-        x0 = reshape( A' * (w.*b), N );
-        x0 = ir_wls_init_scale(A, b, x0);
+        % get data for current frame
+        b = aslrec.getframe(kdata,fidx(args.frames(i)),ops{i}.msk,ccmat);
         
         % solve with CG
-        x(:,:,:,i) = cg_solve(x0, A, b, args.niter, ...
-            sprintf('frame %d/%d: ', i, length(args.frames))); % prefix the output message with frame number
+        x(:,:,:,i) = aslrec.reconframe(A{i}, ops{i}.w, b, N, args.niter, ...
+            sprintf('frame %d/%d: ', i, nt), [], x(:,:,:,i)); % prefix the output message with frame number
         
     end
+    stats = aslrec.logstage(stats, 'cg', t0);
     
 end
-
-function x_star = cg_solve(x0, A, b, niter, msg_pfx)
-
-    % set default message prefix
-    if nargin < 5
-        msg_pfx = '';
-    end
-
-    % loop through iterations of conjugate gradient descent
-    x_set = zeros([size(x0),niter+1]);
-    x_star = x0;
-    x_set(:,:,:,1) = x_star;
-    r = reshape(A'*(b - A*x_star), size(x_star));
-    p = r;
-    rsold = r(:)' * r(:);
-    for n = 1:niter
-        fprintf('%sCG iteration %d/%d, res: %.3g\n', msg_pfx, n, niter, rsold);
-        
-        % calculate the gradient descent step
-        AtAp = reshape(A'*(A*p), size(x_star));
-        alpha = rsold / (p(:)' * AtAp(:));
-        x_star = x_star + alpha * p;
-        x_set(:,:,:,n+1) = x_star;
-
-        % calculate new residual
-        r = r - alpha * AtAp;
-        rsnew = r(:)' * r(:);
-        p = r + (rsnew / rsold) * p;
-        rsold = rsnew;
-
-        if exist('exitcg','var')
-            break % set a variable called "exitcg" to exit at current iteration when debugging
-        end
-
-    end
-    
-end
\ No newline at end of file
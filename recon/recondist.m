@@ -0,0 +1,277 @@
+function [x, stats] = recondist(varargin)
+% Function for distributed CG-SENSE NUFFT reconstruction of umvsasl data
+%   across the workers of a parallel pool (i.e. across multiple nodes)
+%
+% by David Frey
+%
+% Usage:
+% Same as recon3dflex, with the pool set up from a cluster profile. The
+%   workers are split into groups of coilpart workers, and each group
+%   reconstructs one frame at a time. With coilpart > 1 the coils (data and
+%   SENSE map) of a frame are partitioned across the workers of its group,
+%   and the partial adjoints of each CG iteration are summed within the
+%   group over MPI (labSend/labReceive). The density compensation is
+%   computed once on the client, then the operator is shipped as its
+%   description (klocs, N, fov and the weights) and each worker builds its
+%   own NUFFT (no DCF iterations) and its slice of the SENSE operator.
+%   Frames are served from a work queue: the data is handed to worker 1
+%   (the dispatcher), which sends the next frame to a group as soon as it
+%   returns its last image, and streams the images to x or outfile. Only
+%   workers in a group with frames to recon build an operator.
+%   To test on a single machine, use the 'local' (or 'Processes') profile
+%   to run the workers as local processes.
+%
+% Required paths:
+%   - MIRT (git@github.com:JeffFessler/mirt.git), on the workers too
+%   - Parallel Computing Toolbox (MATLAB Parallel Server for multiple nodes)
+%
+% Arguments:
+%   - pfile: pfile name search string, leave empty to use first P*.7 file
+%       in current working directory
+%   - smap: sensitivity map, [] or 'calib' (see recon3dflex)
+%   - niter: number of iterations for CG reconstruction
+%   - ccfac: coil compression factor
+%   - frames: frame indicies to reconstruct (default is all frames)
+%   - profile: cluster profile to start the pool with
+%   - nworkers: number of workers (default is the profile's default)
+%   - coilpart: number of workers to partition the coils of each frame
+%       across (1 reconstructs each frame on a single worker), the pool
+%       needs at least coilpart+1 workers
+%   - outfile: .mat file to stream the images to (saved as x, one frame at
+%       a time by the dispatcher, so it must be on a filesystem shared with
+%       worker 1), leave empty to return them in x instead
+%
+% Outputs:
+%   - x: reconstructed images [image size x nframes] (single precision),
+%       empty if outfile is set
+%   - stats: elapsed time (s) and resident memory (MB) of the client at the
+%       end of each stage (read, smap, cc, pool, nufft, dcf, op, cg)
+%
+
+    % check that mirt is set up
+    aslrec.check4mirt();
+
+    % set defaults
+    defaults.pfile = [];
+    defaults.smap = [];
+    defaults.niter = 0;
+    defaults.ccfac = 1;
+    defaults.frames = [];
+    defaults.profile = parallel.defaultClusterProfile;
+    defaults.nworkers = [];
+    defaults.coilpart = 1;
+    defaults.outfile = [];
+
+    % parse input parameters
+    args = vararg_pair(defaults,varargin);
+
+    % read and prepare the data on the client
+    [kdata,klocs,N,fov,smap,stats,kmsk,ccmat,fidx] = aslrec.prepdata('pfile', args.pfile, ...
+        'smap', args.smap, 'ccfac', args.ccfac);
+
+    if size(klocs,4) > 1
+        error('views are rotated across frames, use reconjoint or recon3dflex');
+    end
+
+    % get sizes
+    nframes = length(fidx); % number of frames
+    ncoils = size(kdata,4); % number of coils
+    if ~isempty(ccmat)
+        ncoils = size(ccmat,2); % number of compressed coils
+    end
+    if isempty(args.frames)
+        args.frames = 1:nframes; % default - use all frames
+    end
+    if args.coilpart > ncoils
+        warning('only %d coils, setting coilpart = %d', ncoils, ncoils);
+        args.coilpart = ncoils;
+    end
+    coilpart = args.coilpart;
+
+    % start the pool
+    t0 = tic;
+    pool = gcp('nocreate');
+    if isempty(pool) || ~strcmp(pool.Cluster.Profile, args.profile) || ...
+            (~isempty(args.nworkers) && pool.NumWorkers ~= args.nworkers)
+        delete(pool);
+        if isempty(args.nworkers)
+            pool = parpool(args.profile);
+        else
+            pool = parpool(args.profile, args.nworkers);
+        end
+    end
+    nworkers = pool.NumWorkers;
+    ngroups = floor((nworkers-1)/coilpart); % lab 1 is the dispatcher
+    if ngroups < 1
+        error('recondist needs at least coilpart+1 (%d) workers, pool has %d', coilpart+1, nworkers);
+    end
+    ngroups = min(ngroups, length(args.frames)); % no more groups than frames
+    fprintf('recondist: %d workers: 1 dispatcher, %d groups of %d (%d idle)\n', ...
+        nworkers, ngroups, coilpart, nworkers - 1 - ngroups*coilpart);
+    stats = aslrec.logstage(stats, 'pool', t0);
+
+    % assign workers to groups and coils
+    cedges = round(linspace(0, ncoils, coilpart+1));
+    grp = zeros(1,nworkers); % group of each worker (0 = dispatcher or idle)
+    coils = cell(1,nworkers); % coils of each worker
+    for lab = 2:ngroups*coilpart+1
+        grp(lab) = ceil((lab-1)/coilpart);
+        p = mod(lab-2, coilpart) + 1;
+        coils{lab} = cedges(p)+1:cedges(p+1);
+    end
+
+    % send each worker its slice of the SENSE map
+    smapC = Composite();
+    for lab = 1:nworkers
+        if isempty(smap) || grp(lab) == 0
+            smapC{lab} = [];
+        else
+            smapC{lab} = smap(:,:,:,coils{lab});
+        end
+    end
+    clear smap
+
+    % calculate the density compensation once on the client
+    [op, stats] = aslrec.buildop(klocs,N,fov,stats,kmsk);
+    w = op.w;
+    msk = op.msk;
+    clear op
+
+    % build the operators on the workers with frames to recon
+    t0 = tic;
+    spmd
+        A = [];
+        if grp(labindex) > 0
+            op = aslrec.buildop(klocs,N,fov,[],kmsk,w);
+            A = op.A;
+            if ~isempty(smapC) % sensitivity encoding
+                A = Asense(A,smapC);
+            end
+            clear op
+        end
+    end
+    clear smapC klocs
+    stats = aslrec.logstage(stats, 'op', t0);
+
+    % hand the data to the dispatcher
+    kdataC = Composite();
+    kdataC{1} = kdata;
+    for lab = 2:nworkers
+        kdataC{lab} = [];
+    end
+    clear kdata
+    outfile = args.outfile;
+    if ~isempty(outfile) && ~startsWith(outfile, filesep) % the dispatcher writes it
+        outfile = fullfile(pwd, outfile);
+    end
+
+    % recon the frames from a work queue: each group leader asks the
+    %   dispatcher for a frame when it is done with the last one, and the
+    %   dispatcher sends the coil slices of the next frame to the group and
+    %   streams the returned images to x or outfile
+    t0 = tic;
+    frames = args.frames;
+    niter = args.niter;
+    spmd
+        xC = [];
+        if labindex == 1
+            xC = dispatch(kdataC, fidx(frames), msk, ccmat, grp, coils, coilpart, N, outfile);
+        elseif grp(labindex) > 0
+            labs = 1 + (grp(labindex)-1)*coilpart + (1:coilpart);
+            reconqueue(A, w, N, niter, length(frames), labs);
+        end
+    end
+    clear kdataC
+    x = xC{1};
+    stats = aslrec.logstage(stats, 'cg', t0);
+    fprintf('recondist: %d frames in %.1f s (%.3f frames/s on %d workers)\n', ...
+        length(frames), stats.cg.time, length(frames)/stats.cg.time, nworkers);
+
+end
+
+function x = dispatch(kdata, fidx, msk, ccmat, grp, coils, coilpart, N, outfile)
+% serve frames to the group leaders on request and collect their images
+
+    nt = length(fidx);
+    if isempty(outfile)
+        x = zeros([N(:)',nt],'single');
+    else
+        x = [];
+        out = matfile(outfile, 'Writable', true);
+    end
+
+    next = 1;
+    nactive = max(grp);
+    while nactive > 0
+
+        % wait for a leader to return an image (or ask for its 1st frame)
+        [msg, leader] = labReceive('any', 2);
+        if msg{1} > 0
+            if isempty(outfile)
+                x(:,:,:,msg{1}) = msg{2};
+            else
+                out.x(:,:,:,msg{1}) = msg{2};
+            end
+        end
+
+        % send the next frame to the leader's group, or tell it to stop
+        labs = leader + (0:coilpart-1);
+        if next <= nt
+            b = aslrec.getframe(kdata, fidx(next), msk, ccmat);
+            for lab = labs
+                labSend({next, b(:,coils{lab})}, lab, 1);
+            end
+            next = next + 1;
+        else
+            for lab = labs
+                labSend({0, []}, lab, 1);
+            end
+            nactive = nactive - 1;
+        end
+
+    end
+
+end
+
+function reconqueue(A, w, N, niter, nt, labs)
+% recon frames from the dispatcher until it runs out, the group leader
+%   returns the images
+
+    i = 0;
+    x = [];
+    while true
+        if labindex == labs(1) % return the last image and ask for the next frame
+            labSend({i, x}, 1, 2);
+        end
+        msg = labReceive(1, 1);
+        i = msg{1};
+        if i == 0
+            break
+        end
+        x = aslrec.reconframe(A, w, msg{2}, N, niter, ...
+            sprintf('frame %d/%d: ', i, nt), @(x) groupsum(x, labs));
+    end
+
+end
+
+function x = groupsum(x, labs)
+% sum x over the workers in labs, result is returned on all of them
+
+    if length(labs) < 2
+        return
+    end
+
+    % gather to the group leader
+    if labindex == labs(1)
+        for lab = labs(2:end)
+            x = x + labReceive(lab);
+        end
+        for lab = labs(2:end)
+            labSend(x, lab);
+        end
+    else
+        labSend(x, labs(1));
+        x = labReceive(labs(1));
+    end
+
+end
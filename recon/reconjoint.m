@@ -0,0 +1,209 @@
+function [x, stats] = reconjoint(varargin)
+% Function for joint multi-frame SENSE NUFFT reconstruction of undersampled
+%   umvsasl data with temporal regularization
+%
+% by David Frey
+%
+% Usage:
+% Same data setup as recon3dflex. Intended for scans with fewer arms/shots
+%   per frame (narms or opnshots reduced by 2-4x) and the views rotated by
+%   the golden angle from frame to frame (frame_rot = 1 in umvsasl.e), so
+%   each frame samples different kspace locations. All frames are solved
+%   together with FISTA:
+%       min_x sum_t 1/2 ||A_t x_t - b_t||^2 + R(x)
+%   where A_t is the NUFFT (SENSE) operator of frame t and R is either:
+%   - 'lowrank': nuclear norm of the casorati matrix [nvox x nframes],
+%       applied by singular value thresholding (computed from the
+%       nframes x nframes gram matrix, so no large SVD is needed)
+%   - 'tfd': l1 norm of the temporal finite differences at lag tstride,
+%       applied with a few dual projected gradient iterations. The default
+%       lag of 2 differences label-label and control-control frames, so the
+%       perfusion signal is not smoothed away.
+%   The step size is set from a power iteration estimate of ||A_t'A_t||.
+%   Each iteration costs one NUFFT pair per frame, the same as a CG
+%   iteration of recon3dflex.
+%
+% Required paths:
+%   - MIRT (git@github.com:JeffFessler/mirt.git)
+%
+% Arguments:
+%   - pfile: pfile name search string, leave empty to use first P*.7 file
+%       in current working directory
+%   - smap: sensitivity map, [] or 'calib' (see recon3dflex)
+%   - niter: number of FISTA iterations
+%   - reg: temporal regularizer, 'lowrank' or 'tfd'
+%   - lambda: regularization threshold applied at each step, as a fraction
+%       of the largest singular value ('lowrank') or of the max magnitude
+%       ('tfd') of the initial solution
+%   - tstride: frame lag of the temporal finite differences ('tfd' only)
+%   - nproxiter: number of inner iterations of the 'tfd' proximal step
+%   - resfac: image space resolution upsampling factor
+%   - ccfac: coil compression factor
+%   - frames: frame indicies to reconstruct (default is all frames)
+%
+% Outputs:
+%   - x: reconstructed images [image size x nframes] (single precision)
+%   - stats: elapsed time (s) and resident memory (MB) at the end of each
+%       recon stage (read, smap, cc, op, init, fista), see aslrec.logstage
+%
+
+    % check that mirt is set up
+    aslrec.check4mirt();
+
+    % set defaults
+    defaults.pfile = [];
+    defaults.smap = [];
+    defaults.niter = 30;
+    defaults.reg = 'lowrank';
+    defaults.lambda = 0.02;
+    defaults.tstride = 2;
+    defaults.nproxiter = 10;
+    defaults.resfac = 1;
+    defaults.ccfac = 1;
+    defaults.frames = [];
+
+    % parse input parameters
+    args = vararg_pair(defaults,varargin);
+
+    % read and prepare the data
+    [kdata,klocs,N,fov,smap,stats,kmsk,ccmat,fidx] = aslrec.prepdata('pfile', args.pfile, ...
+        'smap', args.smap, 'resfac', args.resfac, 'ccfac', args.ccfac);
+
+    % get sizes
+    nframes = length(fidx); % number of frames
+    ncoils = size(kdata,4); % number of coils
+    if ~isempty(ccmat)
+        ncoils = size(ccmat,2); % number of compressed coils
+    end
+    if isempty(args.frames)
+        args.frames = 1:nframes; % default - use all frames
+    end
+    nt = length(args.frames);
+    nkframes = size(klocs,4); % number of sets of views
+    if nkframes == 1
+        warning('views are the same for all frames (frame_rot = 0), joint recon will only denoise');
+    end
+
+    % build the operators and get the data for each frame
+    t0 = tic;
+    A = cell(1,nt);
+    w = cell(1,nt);
+    b = cell(1,nt);
+    for i = 1:nt
+        if i == 1 || nkframes > 1
+            fprintf('reconjoint: building operator %d/%d...\n', i, (nkframes > 1)*(nt-1) + 1);
+            op = aslrec.buildop(klocs(:,:,:,min(args.frames(i),nkframes)),N,fov,[],kmsk);
+            if ncoils > 1 % sensitivity encoding
+                op.A = Asense(op.A,smap);
+            end
+        end
+        A{i} = op.A;
+        w{i} = op.w;
+        b{i} = aslrec.getframe(kdata,fidx(args.frames(i)),op.msk,ccmat); % single precision
+    end
+    clear kdata klocs op
+    stats = aslrec.logstage(stats, 'op', t0);
+
+    % initialize with the density compensated adjoint solution of each frame
+    t0 = tic;
+    fprintf("reconjoint: initializing solution x0 = A'*(w.*b)\n");
+    x = zeros(prod(N),nt,'single');
+    for i = 1:nt
+        x0 = reshape( A{i}' * (w{i}.*double(b{i})), N );
+        x(:,i) = single(reshape(ir_wls_init_scale(A{i}, double(b{i}), x0), [], 1));
+    end
+    clear w x0
+
+    % estimate the lipschitz constant of the data term (views of all frames
+    %   have the same density, so the 1st frame is representative)
+    v = randn(N);
+    for n = 1:10
+        v = reshape(A{1}' * (A{1} * v), N);
+        L = norm(v(:));
+        v = v / L;
+    end
+    L = 1.1 * L; % margin for the power iteration and frame-to-frame variation
+    clear v
+
+    % set up the proximal step
+    switch lower(args.reg)
+        case 'lowrank'
+            s = svd(double(x'*x));
+            tau = args.lambda * sqrt(s(1));
+            prox = @(x) svt(x, tau);
+        case 'tfd'
+            tau = args.lambda * max(abs(x(:)));
+            prox = @(x) tfdprox(x, tau, args.tstride, args.nproxiter);
+        otherwise
+            error('invalid regularizer: %s (must be lowrank or tfd)', args.reg);
+    end
+    stats = aslrec.logstage(stats, 'init', t0);
+
+    % solve with FISTA
+    t0 = tic;
+    z = x;
+    t = 1;
+    for n = 1:args.niter
+
+        % gradient step on the data term, one frame at a time
+        xn = zeros(size(x),'single');
+        res = 0;
+        for i = 1:nt
+            zi = double(reshape(z(:,i),N));
+            r = A{i} * zi - double(b{i});
+            res = res + norm(r(:))^2;
+            xn(:,i) = single(zi(:) - reshape(A{i}' * r, [], 1) / L);
+        end
+        fprintf('reconjoint: FISTA iteration %d/%d, res: %.3g\n', n, args.niter, res);
+
+        % proximal step on the temporal regularizer
+        xn = prox(xn);
+
+        % update the momentum
+        tn = (1 + sqrt(1 + 4*t^2)) / 2;
+        z = xn + ((t - 1) / tn) * (xn - x);
+        x = xn;
+        t = tn;
+
+        if exist('exitfista','var')
+            break % set a variable called "exitfista" to exit at current iteration when debugging
+        end
+
+    end
+    x = reshape(x, [N(:)',nt]);
+    stats = aslrec.logstage(stats, 'fista', t0);
+
+end
+
+function x = svt(x, tau)
+% singular value thresholding of the casorati matrix x [nvox x nframes],
+%   using the eigendecomposition of the nframes x nframes gram matrix
+
+    G = double(x'*x);
+    [V,d] = eig((G+G')/2, 'vector');
+    s = sqrt(max(d,0));
+    g = max(s - tau, 0) ./ max(s, eps);
+    x = x * single(V * diag(g) * V');
+
+end
+
+function x = tfdprox(x, tau, tstride, niter)
+% proximal operator of tau*||D x||_1, where D is the temporal finite
+%   difference at lag tstride, by projected gradient on the dual
+
+    nt = size(x,2);
+    if nt <= tstride
+        return
+    end
+
+    D = @(x) x(:,1+tstride:end) - x(:,1:end-tstride);
+    Dt = @(p) [zeros(size(p,1),tstride,'like',p), p] - [p, zeros(size(p,1),tstride,'like',p)];
+
+    p = zeros(size(x,1), nt-tstride, 'like', x);
+    for n = 1:niter
+        p = p + D(x - Dt(p)) / 4; % ||D'D|| <= 4
+        p = p ./ max(abs(p)/tau, 1); % project onto |p| <= tau
+    end
+    x = x - Dt(p);
+
+end
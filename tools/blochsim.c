@@ -0,0 +1,175 @@
+/*
+ * blochsim.c
+ *
+ * by David Frey
+ *
+ * MEX function to simulate the response of many isochromats to an umvsasl
+ * prep pulse at once. Each raster point of the pulse is applied as a hard
+ * pulse (rotation about the effective field), followed by T1/T2 relaxation.
+ * Isochromats are stored as structure-of-arrays and processed in blocks of
+ * BLOCH_LANES so the inner loop over isochromats maps onto SIMD lanes, and
+ * blocks are distributed across threads with OpenMP.
+ *
+ * Usage (from MATLAB):
+ *	M = blochsim(b1r, b1i, g, dt, x0, v, df, b1s, T1, T2)
+ *
+ *	b1r, b1i: real/imag RF waveform (mG), length nt
+ *	g: z gradient waveform (mG/cm), length nt
+ *	dt: raster time (s)
+ *	x0: initial position of each isochromat (cm), length niso
+ *	v: velocity of each isochromat (cm/s), length niso
+ *	df: off-resonance of each isochromat (Hz), length niso
+ *	b1s: B1 scale factor of each isochromat, length niso
+ *	T1, T2: relaxation time constants (s), Inf to disable
+ *	M: final magnetization [3 x niso] (starting from M = [0; 0; 1])
+ *
+ * Compile (from the tools directory):
+ *	mex CFLAGS='$CFLAGS -O3 -march=native -ffast-math -fopenmp' ...
+ *		LDFLAGS='$LDFLAGS -fopenmp' blochsim.c
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "mex.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define BLOCH_GAMMA	(4.258 * 2 * M_PI)	/* gyromagnetic ratio (rad/s/mG) */
+#define BLOCH_LANES	16			/* isochromats per SIMD block */
+
+void blochsim_block(int nt, const float *b1r, const float *b1i, const float *g, float dt,
+		float E1, float E2, int nlanes,
+		const double *x0, const double *v, const double *df, const double *b1s,
+		double *M)
+{
+
+	/* declare block state (structure of arrays) */
+	float mx[BLOCH_LANES], my[BLOCH_LANES], mz[BLOCH_LANES];
+	float b1[BLOCH_LANES], z[BLOCH_LANES], vz[BLOCH_LANES], bz0[BLOCH_LANES];
+	int n, l;
+
+	/* load isochromat parameters, pad unused lanes with a null isochromat */
+	for (l = 0; l < BLOCH_LANES; l++) {
+		mx[l] = 0.0;
+		my[l] = 0.0;
+		mz[l] = 1.0;
+		b1[l] = (l < nlanes) ? (float)b1s[l] : 0.0;
+		z[l] = (l < nlanes) ? (float)x0[l] : 0.0;
+		vz[l] = (l < nlanes) ? (float)(v[l] * dt) : 0.0;
+		bz0[l] = (l < nlanes) ? (float)(df[l] / 4.258) : 0.0; /* Hz -> mG */
+	}
+
+	/* loop through time points */
+	for (n = 0; n < nt; n++) {
+
+#pragma omp simd
+		for (l = 0; l < BLOCH_LANES; l++) {
+			float Bx, By, Bz, Bmag, inv, phi, c, s, nx, ny, nz, ndotm;
+			float cx, cy, cz;
+
+			/* compute the effective magnetic field (mG) */
+			Bx = b1[l] * b1r[n];
+			By = b1[l] * b1i[n];
+			Bz = g[n] * (z[l] + vz[l] * (float)n) + bz0[l];
+			Bmag = sqrtf(Bx*Bx + By*By + Bz*Bz);
+			inv = (Bmag > 0.0f) ? (1.0f / Bmag) : (0.0f);
+			nx = Bx * inv;
+			ny = By * inv;
+			nz = Bz * inv;
+
+			/* rotate M about the field: dM/dt = gam * M x B */
+			phi = -(float)BLOCH_GAMMA * Bmag * dt;
+			c = cosf(phi);
+			s = sinf(phi);
+			ndotm = nx*mx[l] + ny*my[l] + nz*mz[l];
+			cx = ny*mz[l] - nz*my[l];
+			cy = nz*mx[l] - nx*mz[l];
+			cz = nx*my[l] - ny*mx[l];
+			mx[l] = mx[l]*c + cx*s + nx*ndotm*(1.0f - c);
+			my[l] = my[l]*c + cy*s + ny*ndotm*(1.0f - c);
+			mz[l] = mz[l]*c + cz*s + nz*ndotm*(1.0f - c);
+
+			/* relaxation */
+			mx[l] *= E2;
+			my[l] *= E2;
+			mz[l] = mz[l]*E1 + (1.0f - E1);
+		}
+	}
+
+	/* store the final magnetization */
+	for (l = 0; l < nlanes; l++) {
+		M[3*l] = mx[l];
+		M[3*l + 1] = my[l];
+		M[3*l + 2] = mz[l];
+	}
+
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+
+	int nt, niso, nblocks, blk, n;
+	double dt, T1, T2;
+	float E1, E2;
+	float *b1r, *b1i, *g;
+	double *x0, *v, *df, *b1s, *M;
+
+	/* check the arguments */
+	if (nrhs != 10)
+		mexErrMsgTxt("usage: M = blochsim(b1r, b1i, g, dt, x0, v, df, b1s, T1, T2)");
+	for (n = 0; n < nrhs; n++) {
+		if (!mxIsDouble(prhs[n]) || mxIsComplex(prhs[n]))
+			mexErrMsgTxt("blochsim: all arguments must be real doubles");
+	}
+
+	nt = (int)mxGetNumberOfElements(prhs[0]);
+	if ((int)mxGetNumberOfElements(prhs[1]) != nt || (int)mxGetNumberOfElements(prhs[2]) != nt)
+		mexErrMsgTxt("blochsim: b1r, b1i and g must be the same length");
+
+	niso = (int)mxGetNumberOfElements(prhs[4]);
+	for (n = 5; n < 8; n++) {
+		if ((int)mxGetNumberOfElements(prhs[n]) != niso)
+			mexErrMsgTxt("blochsim: x0, v, df and b1s must be the same length");
+	}
+
+	dt = mxGetScalar(prhs[3]);
+	T1 = mxGetScalar(prhs[8]);
+	T2 = mxGetScalar(prhs[9]);
+	E1 = (float)exp(-dt / T1); /* = 1 for T1 = Inf */
+	E2 = (float)exp(-dt / T2);
+
+	/* convert the waveforms to single precision once */
+	b1r = (float *)mxMalloc(nt*sizeof(float));
+	b1i = (float *)mxMalloc(nt*sizeof(float));
+	g = (float *)mxMalloc(nt*sizeof(float));
+	for (n = 0; n < nt; n++) {
+		b1r[n] = (float)mxGetPr(prhs[0])[n];
+		b1i[n] = (float)mxGetPr(prhs[1])[n];
+		g[n] = (float)mxGetPr(prhs[2])[n];
+	}
+
+	x0 = mxGetPr(prhs[4]);
+	v = mxGetPr(prhs[5]);
+	df = mxGetPr(prhs[6]);
+	b1s = mxGetPr(prhs[7]);
+
+	plhs[0] = mxCreateDoubleMatrix(3, niso, mxREAL);
+	M = mxGetPr(plhs[0]);
+
+	/* loop through blocks of isochromats in parallel */
+	nblocks = (niso + BLOCH_LANES - 1) / BLOCH_LANES;
+#pragma omp parallel for schedule(dynamic)
+	for (blk = 0; blk < nblocks; blk++) {
+		int i0 = blk * BLOCH_LANES;
+		int nlanes = (niso - i0 < BLOCH_LANES) ? (niso - i0) : (BLOCH_LANES);
+		blochsim_block(nt, b1r, b1i, g, (float)dt, E1, E2, nlanes,
+				x0 + i0, v + i0, df + i0, b1s + i0, M + 3*i0);
+	}
+
+	mxFree(b1r);
+	mxFree(b1i);
+	mxFree(g);
+
+}
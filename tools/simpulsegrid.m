@@ -0,0 +1,100 @@
+function [eff, ctldiff, Mz_lbl, Mz_ctl] = simpulsegrid(varargin)
+% Function to simulate labeling efficiency of umvsasl prep pulses over a
+%   grid of isochromat velocities, off-resonances and B1 scales using the
+%   blochsim mex function (SIMD/multithreaded hard-pulse integrator)
+%
+% by David Frey
+%
+% Required: MIRT (git@github.com:JeffFessler/mirt.git)
+%
+% Usage:
+%   Specify a pulse using 'id' (reads from scanner/aslprep/pulses/<id>) or
+%   'pulsedir', or run this function from a pulse directory containing the
+%   files rho.txt, theta.txt, and grad.txt. The label (1st column) and
+%   control (2nd column) waveforms are both simulated.
+%
+% Arguments:
+%   - id: prep pulse id number, leave empty to use pulsedir
+%   - pulsedir: directory containing rho.txt, theta.txt, and grad.txt
+%   - B1max: peak B1 (mG) amplitude corresponding to uint16 max
+%   - Gmax: peak gradient (G/cm) amplitude corresponding to uint16 max
+%   - zero_ctl_grads: option to zero out control gradients (same as cv)
+%   - v: isochromat velocities (cm/s)
+%   - df: isochromat off-resonance frequencies (Hz)
+%   - b1s: isochromat B1 scale factors
+%   - x0: initial isochromat positions (cm), magnetization is averaged
+%       across positions (intra-voxel dephasing)
+%   - T1: isochromat longitudinal magnetization relaxation time constant (s)
+%   - T2: isochromat transverse magnetization relaxation time constant (s)
+%   - dt: sampling interval (s)
+%
+% Outputs (all [length(v) x length(df) x length(b1s)]):
+%   - eff: labeling efficiency, (Mz_ctl - Mz_lbl)/2
+%   - ctldiff: control difference from relaxed magnetization, 1 - Mz_ctl
+%   - Mz_lbl: longitudinal magnetization after label pulse
+%   - Mz_ctl: longitudinal magnetization after control pulse
+%
+
+    % set defaults
+    defaults.id = [];
+    defaults.pulsedir = '.';
+    defaults.B1max = 117;
+    defaults.Gmax = 1.5;
+    defaults.zero_ctl_grads = 0;
+    defaults.v = linspace(-50,50,101);
+    defaults.df = 0;
+    defaults.b1s = 1;
+    defaults.x0 = linspace(-0.5,0.5,20);
+    defaults.T1 = Inf;
+    defaults.T2 = Inf;
+    defaults.dt = 4e-6;
+
+    % parse input parameters
+    args = vararg_pair(defaults, varargin);
+
+    % compile the simulator if needed
+    if exist('blochsim','file') ~= 3
+        srcdir = fileparts(mfilename('fullpath'));
+        fprintf('compiling %s/blochsim.c...\n', srcdir);
+        mex('-outdir', srcdir, ...
+            'CFLAGS=$CFLAGS -O3 -march=native -ffast-math -fopenmp', ...
+            'LDFLAGS=$LDFLAGS -fopenmp', [srcdir,'/blochsim.c']);
+    end
+
+    % find the pulse directory
+    if ~isempty(args.id)
+        srcdir = fileparts(mfilename('fullpath'));
+        args.pulsedir = sprintf('%s/../scanner/aslprep/pulses/%05d', srcdir, args.id);
+    end
+
+    % load in and scale the pulse waveforms
+    rho = load([args.pulsedir,'/rho.txt']);
+    theta = load([args.pulsedir,'/theta.txt']);
+    grad = load([args.pulsedir,'/grad.txt']);
+    if args.zero_ctl_grads
+        grad(:,2) = 0;
+    end
+
+    B1 = args.B1max / 32766 * rho .* exp(1i * pi / 32766 * theta);
+    G = 1e3*args.Gmax / 32766 * grad; % mG/cm
+
+    % form the isochromat grid (x0 is the fastest dimension for averaging)
+    [x0, v, df, b1s] = ndgrid(args.x0, args.v, args.df, args.b1s);
+    dims = [length(args.v), length(args.df), length(args.b1s)];
+    fprintf('simulating %d isochromats x %d time points...\n', numel(x0), size(G,1));
+
+    % simulate the label and control pulses
+    Mz = zeros([dims,2]);
+    for n = 1:2
+        M = blochsim(real(B1(:,n)), imag(B1(:,n)), G(:,n), args.dt, ...
+            x0(:), v(:), df(:), b1s(:), args.T1, args.T2);
+        Mz(:,:,:,n) = reshape(mean(reshape(M(3,:), length(args.x0), []), 1), dims);
+    end
+    Mz_lbl = Mz(:,:,:,1);
+    Mz_ctl = Mz(:,:,:,2);
+
+    % calculate the efficiency maps
+    eff = (Mz_ctl - Mz_lbl) / 2;
+    ctldiff = 1 - Mz_ctl;
+
+end